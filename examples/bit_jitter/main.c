@@ -0,0 +1,165 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_i2c.h>
+#include <esp_ow.h>
+#include <esp_sdo.h>
+#include <user_interface.h>
+
+#define SCL GPIO0
+#define SDA GPIO2
+#define OW GPIO4
+
+// Number of measurements per routine.
+#define JITTER_RUNS 200
+// Bigger than flash cache so reading it evicts all cached code.
+#define EVICT_WORDS 8192
+
+os_timer_t timer;
+esp_i2c_bus bus;
+
+static const uint32_t evict_data[EVICT_WORDS] ICACHE_RODATA_ATTR = {1};
+
+// Min / max duration in CPU cycles.
+typedef struct {
+  uint32_t min;
+  uint32_t max;
+} jitter;
+
+
+/**
+ * Get CPU cycle counter.
+ *
+ * @return The CCOUNT register value.
+ */
+static inline uint32_t
+get_ccount()
+{
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0, ccount" : "=a" (ccount));
+  return ccount;
+}
+
+/** Read flash data to push code out of the flash cache. */
+static uint32_t ICACHE_FLASH_ATTR
+evict_cache()
+{
+  uint32_t idx;
+  uint32_t sum = 0;
+
+  for (idx = 0; idx < EVICT_WORDS; idx += 8) sum += evict_data[idx];
+
+  return sum;
+}
+
+/**
+ * Add measurement.
+ *
+ * @param jit    The jitter to update.
+ * @param cycles The measured duration in CPU cycles.
+ */
+static void ICACHE_FLASH_ATTR
+jitter_add(jitter *jit, uint32_t cycles)
+{
+  if (cycles < jit->min) jit->min = cycles;
+  if (cycles > jit->max) jit->max = cycles;
+}
+
+/**
+ * Print measurement.
+ *
+ * @param name The measured routine name.
+ * @param jit  The jitter.
+ */
+static void ICACHE_FLASH_ATTR
+jitter_print(const char *name, jitter *jit)
+{
+  os_printf("%s: min %d max %d jitter %d cycles\n",
+            name, jit->min, jit->max, jit->max - jit->min);
+}
+
+/** Measure bit routines with cold flash cache. */
+static void ICACHE_FLASH_ATTR
+bench_jitter()
+{
+  uint16_t idx;
+  uint32_t start;
+  uint16_t rec_us;
+  bool bit;
+  bool ack;
+  jitter ow_rd = {0xFFFFFFFF, 0};
+  jitter ow_wr = {0xFFFFFFFF, 0};
+  jitter i2c_wr = {0xFFFFFFFF, 0};
+
+#ifdef ESP_OW_IRAM
+  os_printf("OneWire bit routines in IRAM\n");
+#else
+  os_printf("OneWire bit routines in flash\n");
+#endif
+#ifdef ESP_I2C_IRAM
+  os_printf("I2C bit routines in IRAM\n");
+#else
+  os_printf("I2C bit routines in flash\n");
+#endif
+
+  esp_ow_init(OW);
+  if (esp_i2c_bus_init(&bus, SCL, SDA) != ESP_I2C_OK) {
+    os_printf("I2C init error\n");
+    return;
+  }
+  esp_i2c_bus_set_speed(&bus, ESP_I2C_SPEED_400);
+
+  for (idx = 0; idx < JITTER_RUNS; idx++) {
+    // Time only the critical part of the slot, recovery is not timing sensitive.
+    evict_cache();
+    start = get_ccount();
+    rec_us = esp_ow_read_slot(OW, &bit);
+    jitter_add(&ow_rd, get_ccount() - start);
+    os_delay_us(rec_us);
+
+    evict_cache();
+    start = get_ccount();
+    rec_us = esp_ow_write_slot(OW, true);
+    jitter_add(&ow_wr, get_ccount() - start);
+    os_delay_us(rec_us);
+
+    // Without a slave the byte is NACKed but timing is the same.
+    evict_cache();
+    start = get_ccount();
+    esp_i2c_bus_write_byte(&bus, 0xA5, &ack);
+    jitter_add(&i2c_wr, get_ccount() - start);
+  }
+
+  jitter_print("OW read slot", &ow_rd);
+  jitter_print("OW write slot", &ow_wr);
+  jitter_print("I2C write byte", &i2c_wr);
+}
+
+void ICACHE_FLASH_ATTR
+user_init()
+{
+  // We don't need WiFi for this example.
+  wifi_station_disconnect();
+  wifi_set_opmode(NULL_MODE);
+
+  stdout_init(BIT_RATE_74880);
+  os_printf("Starting...\n");
+
+  os_timer_disarm(&timer);
+  os_timer_setfn(&timer, (os_timer_func_t *) bench_jitter, NULL);
+  os_timer_arm(&timer, 1500, false);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+
+#include <esp_eeprom.h>
+#include <esp_sdo.h>
+#include <user_interface.h>
+
+#define SCL GPIO0
+#define SDA GPIO2
+
+#define BENCH_LEN 1024
+
+os_timer_t timer;
+esp_i2c_bus bus;
+esp_eeprom ee;
+uint8_t data[BENCH_LEN];
+
+
+/**
+ * Calculate bytes per second.
+ *
+ * @param len The number of bytes.
+ * @param us  The time in microseconds.
+ *
+ * @return Bytes per second.
+ */
+static uint32_t ICACHE_FLASH_ATTR
+bps(uint32_t len, uint32_t us)
+{
+  if (us == 0) return 0;
+  return (uint32_t) (((uint64_t) len * 1000000) / us);
+}
+
+/** Measure EEPROM write and read throughput. */
+static void ICACHE_FLASH_ATTR
+bench_eeprom()
+{
+  uint16_t idx;
+  uint32_t start;
+  uint32_t took;
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_init(&bus, SCL, SDA);
+  if (err != ESP_I2C_OK) {
+    os_printf("I2C init error: %d\n", err);
+    return;
+  }
+  esp_i2c_bus_set_speed(&bus, ESP_I2C_SPEED_400);
+  esp_eeprom_init(&ee, &bus, 0x50, ESP_EEPROM_24C32);
+
+  for (idx = 0; idx < BENCH_LEN; idx++) data[idx] = (uint8_t) idx;
+
+  start = system_get_time();
+  err = esp_eeprom_write(&ee, 0, data, BENCH_LEN);
+  if (err == ESP_I2C_OK) err = esp_eeprom_wait(&ee);
+  took = system_get_time() - start;
+  if (err != ESP_I2C_OK) {
+    os_printf("EEPROM write error: %d\n", err);
+    return;
+  }
+  os_printf("Write: %d bytes in %d us (%d B/s)\n", BENCH_LEN, took, bps(BENCH_LEN, took));
+
+  os_memset(data, 0, BENCH_LEN);
+
+  start = system_get_time();
+  err = esp_eeprom_read(&ee, 0, data, BENCH_LEN);
+  took = system_get_time() - start;
+  if (err != ESP_I2C_OK) {
+    os_printf("EEPROM read error: %d\n", err);
+    return;
+  }
+  os_printf("Read: %d bytes in %d us (%d B/s)\n", BENCH_LEN, took, bps(BENCH_LEN, took));
+
+  for (idx = 0; idx < BENCH_LEN; idx++) {
+    if (data[idx] != (uint8_t) idx) {
+      os_printf("Verify error at: %d\n", idx);
+      return;
+    }
+  }
+  os_printf("Verify OK\n");
+}
+
+void ICACHE_FLASH_ATTR
+user_init()
+{
+  // We don't need WiFi for this example.
+  wifi_station_disconnect();
+  wifi_set_opmode(NULL_MODE);
+
+  stdout_init(BIT_RATE_74880);
+  os_printf("Starting...\n");
+
+  os_timer_disarm(&timer);
+  os_timer_setfn(&timer, (os_timer_func_t *) bench_eeprom, NULL);
+  os_timer_arm(&timer, 1500, false);
+}
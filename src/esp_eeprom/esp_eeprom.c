@@ -0,0 +1,178 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_eeprom.h>
+#include <user_interface.h>
+
+
+/**
+ * Start transaction addressing the device for write.
+ *
+ * While the device is busy with the write cycle it does not
+ * acknowledge its address. The address is sent again after
+ * STOP till it does (ACK polling). On success the bus is left
+ * in transaction so the memory address follows directly.
+ *
+ * @param ee The EEPROM.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+start_poll(esp_eeprom *ee)
+{
+  esp_i2c_err err;
+  uint32_t start = system_get_time();
+
+  do {
+    // STOP is sent only when the device did not acknowledge.
+    err = esp_i2c_bus_start_read_write(ee->bus, ESP_I2C_ADDR_WRITE(ee->address), true);
+    if (err == ESP_I2C_OK) {
+      ee->busy = false;
+      return ESP_I2C_OK;
+    }
+    if (err != ESP_I2C_ERR_NO_ACK || !ee->busy) return err;
+  } while (system_get_time() - start < ESP_EEPROM_WRITE_TIMEOUT_US);
+
+  return ESP_I2C_ERR_NO_ACK;
+}
+
+/**
+ * Start transaction and send memory address.
+ *
+ * @param ee   The EEPROM.
+ * @param addr The memory address.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+start_addr(esp_eeprom *ee, uint32_t addr)
+{
+  esp_i2c_err err;
+  uint8_t buf[2] = {(uint8_t) (addr >> 8), (uint8_t) addr};
+
+  err = start_poll(ee);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_write_bytes(ee->bus, buf, 2);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_init(esp_eeprom *ee, esp_i2c_bus *bus, uint8_t address, uint32_t size, uint16_t page_size)
+{
+  // Writes are split on page boundaries.
+  if (page_size == 0) return ESP_I2C_ERR_BAD_ARG;
+
+  ee->bus = bus;
+  ee->address = address;
+  ee->size = size;
+  ee->page_size = page_size;
+  ee->busy = false;
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_wait(esp_eeprom *ee)
+{
+  esp_i2c_err err;
+
+  if (!ee->busy) return ESP_I2C_OK;
+
+  err = start_poll(ee);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(ee->bus);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_write(esp_eeprom *ee, uint32_t addr, uint8_t *buf, uint16_t len)
+{
+  uint16_t chunk;
+  esp_i2c_err err;
+
+  if (ee->page_size == 0 || addr + len > ee->size) return ESP_I2C_ERR_BAD_ARG;
+
+  while (len > 0) {
+    // Writes must not cross page boundary.
+    chunk = (uint16_t) (ee->page_size - (addr % ee->page_size));
+    if (chunk > len) chunk = len;
+
+    err = start_addr(ee, addr);
+    if (err != ESP_I2C_OK) return err;
+
+    err = esp_i2c_bus_write_bytes(ee->bus, buf, chunk);
+    if (err != ESP_I2C_OK) return err;
+
+    err = esp_i2c_bus_stop(ee->bus);
+    if (err != ESP_I2C_OK) return err;
+
+    // STOP starts internal write cycle.
+    ee->busy = true;
+
+    addr += chunk;
+    buf += chunk;
+    len -= chunk;
+  }
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_read(esp_eeprom *ee, uint32_t addr, uint8_t *buf, uint16_t len)
+{
+  esp_i2c_err err;
+
+  if (len == 0) return ESP_I2C_OK;
+  if (addr + len > ee->size) return ESP_I2C_ERR_BAD_ARG;
+
+  err = start_addr(ee, addr);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_start_read_write(ee->bus, ESP_I2C_ADDR_READ(ee->address), true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_read_bytes(ee->bus, buf, len);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(ee->bus);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_read_stream(esp_eeprom *ee,
+                       uint32_t addr,
+                       uint32_t total,
+                       uint8_t *chunk,
+                       uint16_t chunk_len,
+                       esp_i2c_consumer consumer,
+                       void *arg)
+{
+  esp_i2c_err err;
+
+  if (total == 0) return ESP_I2C_OK;
+  if (chunk_len == 0 || addr + total > ee->size) return ESP_I2C_ERR_BAD_ARG;
+
+  err = start_addr(ee, addr);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_start_read_write(ee->bus, ESP_I2C_ADDR_READ(ee->address), true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_read_stream(ee->bus, chunk, chunk_len, total, consumer, arg);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(ee->bus);
+}
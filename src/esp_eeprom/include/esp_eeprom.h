@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_EEPROM_H
+#define ESP_EEPROM_H
+
+#include <esp_i2c.h>
+
+// Common 16 bit addressed EEPROMs (size in bytes, page size).
+#define ESP_EEPROM_24C32 4096, 32
+#define ESP_EEPROM_24C64 8192, 32
+#define ESP_EEPROM_24C128 16384, 64
+#define ESP_EEPROM_24C256 32768, 64
+#define ESP_EEPROM_24C512 65536, 128
+
+// Maximum write cycle time in microseconds.
+#define ESP_EEPROM_WRITE_TIMEOUT_US 10000
+
+// 24Cxx I2C EEPROM with 16 bit memory addresses.
+typedef struct {
+  esp_i2c_bus *bus;         // The I2C bus.
+  uint8_t address;          // The 7 bit slave address.
+  uint32_t size;            // The memory size in bytes.
+  uint16_t page_size;       // The write page size in bytes.
+  bool busy;                // Set when internal write cycle may be in progress.
+} esp_eeprom;
+
+/**
+ * Initialize EEPROM.
+ *
+ * Example:
+ *
+ *   esp_eeprom_init(&ee, bus, 0x50, ESP_EEPROM_24C32);
+ *
+ * @param ee        The EEPROM.
+ * @param bus       The I2C bus.
+ * @param address   The 7 bit slave address.
+ * @param size      The memory size in bytes.
+ * @param page_size The write page size in bytes.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_BAD_ARG when page_size is zero.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_init(esp_eeprom *ee, esp_i2c_bus *bus, uint8_t address, uint32_t size, uint16_t page_size);
+
+/**
+ * Wait for internal write cycle to finish.
+ *
+ * Uses ACK polling: the device does not acknowledge its
+ * address till the write cycle is finished. Reads and writes
+ * poll on their own and continue with the memory address
+ * right after the acknowledged device address.
+ *
+ * @param ee The EEPROM.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_NO_ACK on timeout.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_wait(esp_eeprom *ee);
+
+/**
+ * Write bytes.
+ *
+ * Writes are split at page boundaries. Each page write is followed
+ * by the write cycle which next operation waits for with ACK polling.
+ *
+ * @param ee   The EEPROM.
+ * @param addr The memory address.
+ * @param buf  The data to write.
+ * @param len  The number of bytes to write.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_write(esp_eeprom *ee, uint32_t addr, uint8_t *buf, uint16_t len);
+
+/**
+ * Sequential read.
+ *
+ * @param ee   The EEPROM.
+ * @param addr The memory address.
+ * @param buf  The buffer to read data to.
+ * @param len  The number of bytes to read.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_read(esp_eeprom *ee, uint32_t addr, uint8_t *buf, uint16_t len);
+
+/**
+ * Sequential read of any size passed to consumer in chunks.
+ *
+ * @param ee        The EEPROM.
+ * @param addr      The memory address.
+ * @param total     The number of bytes to read.
+ * @param chunk     The chunk buffer.
+ * @param chunk_len The chunk buffer size.
+ * @param consumer  The chunk consumer.
+ * @param arg       The argument passed to consumer.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_BAD_ARG when chunk_len is zero.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_eeprom_read_stream(esp_eeprom *ee,
+                       uint32_t addr,
+                       uint32_t total,
+                       uint8_t *chunk,
+                       uint16_t chunk_len,
+                       esp_i2c_consumer consumer,
+                       void *arg);
+
+#endif //ESP_EEPROM_H
@@ -16,439 +16,1840 @@
 
 
 #include <esp_i2c.h>
+#include <osapi.h>
 #include <mem.h>
+#include <user_interface.h>
+#include "esp_i2c_priv.h"
 
 
-// Set to true when I2C is initialized.
+// Set to true when default I2C bus is initialized.
 static bool init;
-// GPIO number assigned to clock.
-static uint8_t gpio_scl;
-// GPIO number assigned to data.
-static uint8_t gpio_sda;
-// In transaction when between START and STOP conditions.
-static bool in_trans;
-
-// Maximum time slave can stretch the clock.
-static uint32_t max_cs;
-
-// The default delays to use in functions.
-static uint8_t i2c_delay_short;
-static uint8_t i2c_delay_long;
-
-// Makes GPIO an output and because GPIO_OUT for this bit
-// is 0 it will pull bus low.
-#define SDA_LOW() (GPIO_OUT_EN_S = (0x1 << (gpio_sda)))
-#define SCL_LOW() (GPIO_OUT_EN_S = (0x1 << (gpio_scl)))
-
-// Make GPIO an input and since there are pull up resistors
-// on the bus they will pull bus line high unless
-// some device is actively driving it low.
-// This is handy for SCL because when it's high we want to read it state.
-#define SDA_RELEASE() (GPIO_OUT_EN_C = (0x1 << (gpio_sda)))
-#define SCL_RELEASE() (GPIO_OUT_EN_C = (0x1 << (gpio_scl)))
-
-// Read GPIO state. Can be called only after *_RELEASE since only then
-// GPIO is setup as input.
-#define SDA_READ() ((GPIO_IN & (0x1 << (gpio_sda))) != 0)
-#define SCL_READ() ((GPIO_IN & (0x1 << (gpio_scl))) != 0)
-
-// I2C bus states.
-#define ESP_I2C_HIGH true
-#define ESP_I2C_LO false
+// The bus used by functions not taking bus argument.
+static esp_i2c_bus default_bus;
+// The priority of the task finishing transactions stepped from interrupt handler.
+static uint8_t async_prio;
+// The queue of the task finishing transactions stepped from interrupt handler.
+static os_event_t async_queue[ESP_I2C_ASYNC_QUEUE];
+
+// Default maximum clock stretch in microseconds.
+#define ESP_I2C_MAX_CS_US 1000
+
+// Number of bits clocked during calibration.
+#define ESP_I2C_CALIBRATION_BITS 64
 
 /**
- * Delay doing nothing.
+ * Account clock stretch in bus and device statistics.
  *
- * @param count The number of noop loops.
+ * Placed in IRAM, called from esp_i2c_bus_async_isr_step.
+ *
+ * @param bus The I2C bus.
+ * @param us  The clock stretch in microseconds.
  */
-static void ICACHE_FLASH_ATTR
-delay(uint8_t count)
+static void
+cs_account(esp_i2c_bus *bus, uint32_t us)
 {
-  uint8_t idx;
-  #pragma GCC diagnostic push
-  #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
-  uint32_t reg;
-  #pragma GCC diagnostic pop
+  bus->stats.cs_count++;
+  bus->stats.cs_total_us += us;
+  if (us > bus->stats.cs_max_us) bus->stats.cs_max_us = us;
+  if (bus->profile != NULL && us > bus->profile->cs_max_us) bus->profile->cs_max_us = us;
+}
+
+uint32_t ESP_I2C_BIT_ATTR
+esp_i2c_chk_cs(esp_i2c_bus *bus)
+{
+  uint32_t start;
+  uint32_t cycles;
 
-  for (idx = 0; idx < count; idx++) reg = GPIO_IN;
+  if (SCL_READ(bus) == ESP_I2C_HIGH) return 0;
+
+  start = get_ccount();
+  while (SCL_READ(bus) == ESP_I2C_LO) {
+    if (get_ccount() - start >= bus->max_cs) {
+      bus->stats.cs_timeouts++;
+      return ESP_I2C_CS_TIMEOUT;
+    }
+  }
+  cycles = get_ccount() - start;
+
+  // Shorter waits are SCL rise time not slave stretching the clock.
+  if (cycles > bus->delay_short) cs_account(bus, cycles / bus->cpu_mhz);
+
+  return cycles;
 }
 
 /**
- * Check clock stretching.
+ * Set clock stretch limit in CPU cycles for current device.
+ *
+ * Also caches the CPU frequency so bit level code does not call the SDK.
  *
- * @return The clock stretching time.
+ * @param bus The I2C bus.
  */
-static uint8_t ICACHE_FLASH_ATTR
-chk_cs()
+static void ICACHE_FLASH_ATTR
+apply_cs(esp_i2c_bus *bus)
 {
-  uint8_t idx = 0;
-
-  while (SCL_READ() == ESP_I2C_LO && (idx++) < max_cs);
+  if (bus->profile != NULL && bus->profile->max_cs_us > 0) {
+    bus->cs_us = bus->profile->max_cs_us;
+  } else {
+    bus->cs_us = bus->max_cs_us;
+  }
 
-  return idx;
+  bus->cpu_mhz = (uint8_t) system_get_cpu_freq();
+  bus->max_cs = bus->cs_us * bus->cpu_mhz;
 }
 
-esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_fail_fast(esp_i2c_err err)
+esp_i2c_err
+esp_i2c_bus_fail_fast(esp_i2c_bus *bus, esp_i2c_err err)
 {
-  SCL_RELEASE();
-  SDA_RELEASE();
-  in_trans = false;
+  SCL_RELEASE(bus);
+  SDA_RELEASE(bus);
+  bus->in_trans = false;
+  bus->ten_addr = ESP_I2C_ADDR10_NONE;
 
   return err;
 }
 
 /**
- * Advance the clock one cycle.
+ * Count lost arbitration and release the bus.
  *
- * One clock tick:
- *    ____
- * __/    \__
+ * Placed in IRAM, called from esp_i2c_bus_async_isr_step.
  *
- * SHORT LOW -> LONG HIGH -> SHORT LOW
+ * @param bus The I2C bus.
  *
- * LONG = 2 * SHORT
+ * @return Always ESP_I2C_ERR_ARB_LOST.
+ */
+static esp_i2c_err
+arb_lost(esp_i2c_bus *bus)
+{
+  bus->stats.arb_lost++;
+
+  return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_ARB_LOST);
+}
+
+/**
+ * Set bit timing for the speed.
  *
- * @return The I2C error code.
+ * @param bus     The I2C bus.
+ * @param freq_hz The SCL frequency in Hz.
  */
-static esp_i2c_err ICACHE_FLASH_ATTR
-tick()
+static void ICACHE_FLASH_ATTR
+apply_speed(esp_i2c_bus *bus, uint32_t freq_hz)
 {
-  delay(i2c_delay_short);
-  SCL_RELEASE();
+  // The bit period in CPU cycles.
+  uint32_t period = system_get_cpu_freq() * 1000000 / freq_hz;
 
-  if (chk_cs() == max_cs) return esp_i2c_fail_fast(ESP_I2C_ERR_LONG_STRETCH);
+  bus->speed = freq_hz;
 
-  // Keep clock high.
-  delay(i2c_delay_long);
-  SCL_LOW();
-  delay(i2c_delay_short);
+  // Each bit is made of four short delays (LONG = 2 * SHORT).
+  bus->delay_short = period > bus->overhead ? (period - bus->overhead) / 4 : 0;
+  bus->delay_long = 2 * bus->delay_short;
 
-  return ESP_I2C_OK;
+  // Clock stretch limit is in CPU cycles too.
+  apply_cs(bus);
+  bus->crit_max = bus->crit_max_us * system_get_cpu_freq();
 }
 
-void ICACHE_FLASH_ATTR
-esp_i2c_set_speed(uint8_t speed)
+/**
+ * Get the fastest speed bit timing can produce.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return The speed in Hz (0 - not calibrated bus, no known limit).
+ */
+static uint32_t ICACHE_FLASH_ATTR
+max_speed(esp_i2c_bus *bus)
 {
-  // The default delays.
-  i2c_delay_short = speed;
-  i2c_delay_long = (uint8_t) (2 * i2c_delay_short);
+  // Bit with no delays takes the overhead only.
+  if (bus->overhead == 0) return 0;
+
+  return system_get_cpu_freq() * 1000000 / bus->overhead;
 }
 
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_init(uint8_t scl_gpio_num, uint8_t sda_gpio_num)
+esp_i2c_bus_set_speed(esp_i2c_bus *bus, uint32_t freq_hz)
 {
-  // Check double initialization.
-  if (init) {
-    if (gpio_scl == scl_gpio_num && gpio_sda == sda_gpio_num) return ESP_I2C_OK;
-    else return ESP_I2C_ERR_INIT_CONFLICT;
+  // Bit period is computed by dividing by the frequency.
+  if (freq_hz == 0) return ESP_I2C_ERR_BAD_ARG;
+
+  bus->default_speed = freq_hz;
+  apply_speed(bus, freq_hz);
+
+  return ESP_I2C_OK;
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_use_profile(esp_i2c_bus *bus, uint16_t address)
+{
+  uint8_t idx;
+  uint32_t speed;
+
+  bus->profile = NULL;
+  for (idx = 0; idx < bus->profiles_num; idx++) {
+    if (bus->profiles[idx].address == address) {
+      bus->profile = &bus->profiles[idx];
+      break;
+    }
   }
 
-  init = true;
+  apply_cs(bus);
+
+  speed = bus->profile != NULL && bus->profile->speed > 0 ? bus->profile->speed : bus->default_speed;
+  if (speed != bus->speed) apply_speed(bus, speed);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_init(esp_i2c_bus *bus, uint8_t scl_gpio_num, uint8_t sda_gpio_num)
+{
+  os_memset(bus, 0, sizeof(esp_i2c_bus));
 
   // Configure as GPIOs.
   esp_gpio_setup(scl_gpio_num, GPIO_MODE_INPUT);
   esp_gpio_setup(sda_gpio_num, GPIO_MODE_INPUT);
 
-  // Set global variables.
-  gpio_scl = scl_gpio_num;
-  gpio_sda = sda_gpio_num;
+  bus->gpio_scl = scl_gpio_num;
+  bus->gpio_sda = sda_gpio_num;
+  bus->scl_mask = (uint32_t) 0x1 << scl_gpio_num;
+  bus->sda_mask = (uint32_t) 0x1 << sda_gpio_num;
 
   // Maximum clock stretch.
-  max_cs = 230 * 3;
+  bus->max_cs_us = ESP_I2C_MAX_CS_US;
+  apply_cs(bus);
+
+  // Not calibrated bus is never faster than requested.
+  bus->overhead = 0;
 
   // The default speed.
-  esp_i2c_set_speed(ESP_I2C_SPEED_100);
+  esp_i2c_bus_set_speed(bus, ESP_I2C_SPEED_100);
 
-  in_trans = false;
+  bus->async_tick_us = ESP_I2C_ASYNC_MIN_TICK_US;
+  bus->in_trans = false;
+  bus->ten_addr = ESP_I2C_ADDR10_NONE;
+
+  // Retry policy for multi-master buses.
+  bus->retry.retries = 3;
+  bus->retry.mask = ESP_I2C_RETRY_ON(ESP_I2C_ERR_ARB_LOST) | ESP_I2C_RETRY_ON(ESP_I2C_ERR_BUS_STUCK);
+  bus->retry.backoff_us = 50;
 
   return ESP_I2C_OK;
 }
 
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_set_max_stretch(esp_i2c_bus *bus, uint32_t max_us)
+{
+  bus->max_cs_us = max_us;
+  apply_cs(bus);
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_set_profiles(esp_i2c_bus *bus, esp_i2c_profile *profiles, uint8_t num)
+{
+  bus->profiles = profiles;
+  bus->profiles_num = num;
+  bus->profile = NULL;
+  apply_cs(bus);
+}
+
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_start()
+esp_i2c_bus_start(esp_i2c_bus *bus)
 {
-  uint8_t idx = 0;
+  uint32_t cs;
 
-  if (in_trans) {
+  // Bus is driven by asynchronous engine.
+  if (bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  // START followed by any address deselects 10 bit slave.
+  bus->ten_addr = ESP_I2C_ADDR10_NONE;
+
+  if (bus->in_trans) {
     // We are within transaction so we can assume:
     // - SCL is LO.
     // - SDA is HIGH.
     // - We are in the middle of low clock cycle.
 
-    delay(i2c_delay_short);
-    SCL_RELEASE();
-    delay(i2c_delay_short);
+    delay(bus->delay_short);
+    SCL_RELEASE(bus);
+    delay(bus->delay_short);
 
-    if ((idx = chk_cs()) == max_cs) return esp_i2c_fail_fast(ESP_I2C_ERR_LONG_STRETCH);
+    if ((cs = esp_i2c_chk_cs(bus)) == ESP_I2C_CS_TIMEOUT) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
 
     // If there was clock stretching we need to delay
     // before driving SDA low.
-    if (idx > 0) delay(i2c_delay_short);
+    if (cs > 0) delay(bus->delay_short);
 
-    SDA_LOW();
-    delay(i2c_delay_short);
-    SCL_LOW();
-    delay(i2c_delay_short);
+    // Check for arbitration.
+    if (SDA_READ(bus) == ESP_I2C_LO) return arb_lost(bus);
 
-    SDA_RELEASE();
+    SDA_LOW(bus);
+    delay(bus->delay_short);
+    SCL_LOW(bus);
+    delay(bus->delay_short);
+
+    SDA_RELEASE(bus);
 
     return ESP_I2C_OK;
   }
 
   // We are not in transaction so SCL and SDA might be in any state.
 
-  SCL_RELEASE();
-  SDA_RELEASE();
+  SCL_RELEASE(bus);
+  SDA_RELEASE(bus);
 
-  // Check for arbitration.
-  if (SDA_READ() == ESP_I2C_LO) return ESP_I2C_ERR_ARB_LOST;
+  // SDA held low before START is a bus fault, not lost arbitration.
+  if (SDA_READ(bus) == ESP_I2C_LO) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_BUS_STUCK);
 
-  if (chk_cs() == max_cs) return esp_i2c_fail_fast(ESP_I2C_ERR_LONG_STRETCH);
+  if (esp_i2c_chk_cs(bus) == ESP_I2C_CS_TIMEOUT) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
 
   // Drive SDA low while SCL is high.
-  delay(i2c_delay_short);
-  SDA_LOW();
-  delay(i2c_delay_short);
+  delay(bus->delay_short);
+  SDA_LOW(bus);
+  delay(bus->delay_short);
 
   // Drive SCL low.
-  SCL_LOW();
-  delay(i2c_delay_short);
+  SCL_LOW(bus);
+  delay(bus->delay_short);
 
   // Release SDA so the next function has
   // a known state (SCL low, SDA high).
-  SDA_RELEASE();
-  in_trans = true;
+  SDA_RELEASE(bus);
+  bus->in_trans = true;
 
   return ESP_I2C_OK;
 }
 
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_stop()
+esp_i2c_bus_stop(esp_i2c_bus *bus)
 {
   // You can issue STOP condition only when in transaction.
-  if (!in_trans) return esp_i2c_fail_fast(ESP_I2C_ERR_STOP_OUTSIDE_TRANS);
+  if (!bus->in_trans) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_STOP_OUTSIDE_TRANS);
+
+  SDA_LOW(bus);
+  delay(bus->delay_short);
 
-  SDA_LOW();
-  delay(i2c_delay_short);
+  SCL_RELEASE(bus);
 
-  SCL_RELEASE();
+  if (esp_i2c_chk_cs(bus) == ESP_I2C_CS_TIMEOUT) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
 
-  if (chk_cs() == max_cs) return esp_i2c_fail_fast(ESP_I2C_ERR_LONG_STRETCH);
+  delay(bus->delay_short);
+  SDA_RELEASE(bus);
+  delay(bus->delay_short);
 
-  delay(i2c_delay_short);
-  SDA_RELEASE();
-  delay(i2c_delay_short);
+  // Other master still drives SDA.
+  if (SDA_READ(bus) == ESP_I2C_LO) return arb_lost(bus);
 
-  SCL_LOW();
-  delay(i2c_delay_short);
+  SCL_LOW(bus);
+  delay(bus->delay_short);
 
-  in_trans = false;
+  bus->in_trans = false;
+  bus->ten_addr = ESP_I2C_ADDR10_NONE;
 
   return ESP_I2C_OK;
 }
 
-static esp_i2c_err ICACHE_FLASH_ATTR
-write_bit(bool bit)
+/**
+ * Disable interrupts for the clock high phase.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return True if interrupts were disabled.
+ */
+static inline bool
+crit_enter(esp_i2c_bus *bus)
 {
-  esp_i2c_err err;
+  if (bus->crit_max_us == 0) return false;
+
+  // High phase is two short delays.
+  if (bus->delay_long > bus->crit_max) {
+    bus->stats.crit_skipped++;
+    return false;
+  }
+
+  ets_intr_lock();
+  bus->stats.crit_slots++;
+
+  return true;
+}
+
+/**
+ * Write one bit.
+ *
+ * One clock tick:
+ *    ____
+ * __/    \__
+ *
+ * SHORT LOW -> LONG HIGH -> SHORT LOW
+ *
+ * LONG = 2 * SHORT
+ *
+ * When bit is 1 SDA is sampled in the middle of the high clock. If other
+ * master drives it low the arbitration is lost and the bus is released.
+ *
+ * @param bus The I2C bus.
+ * @param bit The bit to write.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ESP_I2C_BIT_ATTR
+write_bit(esp_i2c_bus *bus, bool bit)
+{
+  bool crit;
 
   // Set SDA value before next clock tick.
-  (bit) ? SDA_RELEASE() : SDA_LOW();
+  (bit) ? SDA_RELEASE(bus) : SDA_LOW(bus);
+
+  delay(bus->delay_short);
+  SCL_RELEASE(bus);
+
+  if (esp_i2c_chk_cs(bus) == ESP_I2C_CS_TIMEOUT) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
+
+  // Keep clock high.
+  crit = crit_enter(bus);
+  delay(bus->delay_short);
+
+  // Check for arbitration.
+  if (bit && SDA_READ(bus) == ESP_I2C_LO) {
+    if (crit) ets_intr_unlock();
+    return arb_lost(bus);
+  }
 
-  err = tick();
-  if (err != ESP_I2C_OK) return esp_i2c_fail_fast(err);
+  delay(bus->delay_short);
+  SCL_LOW(bus);
+  if (crit) ets_intr_unlock();
+  delay(bus->delay_short);
 
   // Make sure SDA is released so next function has
   // a known state (SCL low, SDA high).
-  if (!bit) SDA_RELEASE();
+  if (!bit) SDA_RELEASE(bus);
 
   return ESP_I2C_OK;
 }
 
+/**
+ * Clock bits with SDA released.
+ *
+ * @param count The number of bits.
+ *
+ * @return The number of CPU cycles it took.
+ */
+static uint32_t ICACHE_FLASH_ATTR
+clock_bits(esp_i2c_bus *bus, uint8_t count)
+{
+  uint8_t idx;
+  uint32_t start = get_ccount();
+
+  for (idx = 0; idx < count; idx++) {
+    if (write_bit(bus, true) != ESP_I2C_OK) return 0;
+  }
+
+  return get_ccount() - start;
+}
+
+/**
+ * Restore bit timing and release the bus after failed calibration.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return Always ESP_I2C_ERR_LONG_STRETCH.
+ */
 static esp_i2c_err ICACHE_FLASH_ATTR
-read_bit(bool *bit)
+calibrate_fail(esp_i2c_bus *bus)
+{
+  apply_speed(bus, bus->default_speed);
+
+  return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_calibrate(esp_i2c_bus *bus, uint32_t *scl_hz)
+{
+  uint32_t cycles;
+
+  if (bus->in_trans || bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  // Calibrate at bus default speed not the last device profile speed.
+  bus->profile = NULL;
+
+  // Known initial state (SCL low, SDA high) without START condition.
+  SDA_RELEASE(bus);
+  SCL_LOW(bus);
+
+  // Measure bit overhead with no delays. Run twice so
+  // the second run is not affected by flash cache misses.
+  bus->delay_short = bus->delay_long = 0;
+  clock_bits(bus, ESP_I2C_CALIBRATION_BITS);
+  cycles = clock_bits(bus, ESP_I2C_CALIBRATION_BITS);
+  if (cycles == 0) return calibrate_fail(bus);
+
+  bus->overhead = cycles / ESP_I2C_CALIBRATION_BITS;
+  apply_speed(bus, bus->default_speed);
+
+  // Measure reached speed.
+  cycles = clock_bits(bus, ESP_I2C_CALIBRATION_BITS);
+  if (cycles == 0) return calibrate_fail(bus);
+
+  SCL_RELEASE(bus);
+
+  *scl_hz = (uint32_t) ((uint64_t) system_get_cpu_freq() * 1000000 * ESP_I2C_CALIBRATION_BITS / cycles);
+
+  return ESP_I2C_OK;
+}
+
+static esp_i2c_err ESP_I2C_BIT_ATTR
+read_bit(esp_i2c_bus *bus, bool *bit)
 {
-  delay(i2c_delay_short);
-  SCL_RELEASE();
+  bool crit;
+
+  delay(bus->delay_short);
+  SCL_RELEASE(bus);
 
-  if (chk_cs() == max_cs) return esp_i2c_fail_fast(ESP_I2C_ERR_LONG_STRETCH);
+  if (esp_i2c_chk_cs(bus) == ESP_I2C_CS_TIMEOUT) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
 
   // Keep clock high.
-  delay(i2c_delay_short);
+  crit = crit_enter(bus);
+  delay(bus->delay_short);
 
   // Sample SDA.
-  *bit = SDA_READ();
+  *bit = SDA_READ(bus);
 
-  delay(i2c_delay_short);
+  delay(bus->delay_short);
 
   // Set clock low.
-  SCL_LOW();
-  delay(i2c_delay_short);
+  SCL_LOW(bus);
+  if (crit) ets_intr_unlock();
+  delay(bus->delay_short);
 
   return ESP_I2C_OK;
 }
 
-esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_write_byte(uint8_t byte, bool *ack_resp)
+esp_i2c_err ESP_I2C_BIT_ATTR
+esp_i2c_bus_write_byte(esp_i2c_bus *bus, uint8_t byte, bool *ack_resp)
 {
   uint8_t mask;
   esp_i2c_err err;
 
   for (mask = 0x80; mask; mask >>= 1) {
-    err = write_bit(((byte & mask) != 0));
+    err = write_bit(bus, ((byte & mask) != 0));
     if (err != ESP_I2C_OK) return err;
   }
 
-  return read_bit(ack_resp);
+  return read_bit(bus, ack_resp);
 }
 
-esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_read_byte(uint8_t *dst, bool ack_type)
+esp_i2c_err ESP_I2C_BIT_ATTR
+esp_i2c_bus_read_byte(esp_i2c_bus *bus, uint8_t *dst, bool ack_type)
 {
   bool bit;
   uint8_t idx;
   esp_i2c_err err;
 
   for (idx = 0; idx < 8; idx++) {
-    err = read_bit(&bit);
+    err = read_bit(bus, &bit);
     if (err != ESP_I2C_OK) return err;
     *dst = (*dst << 1) | bit;
   }
 
-  return write_bit(ack_type);
+  return write_bit(bus, ack_type);
 }
 
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_write_bytes(uint8_t *buf, uint8_t len)
+esp_i2c_bus_write_bytes(esp_i2c_bus *bus, uint8_t *buf, uint16_t len)
 {
-  uint8_t idx;
+  uint16_t idx;
   bool ack_resp;
   esp_i2c_err err;
 
   for (idx = 0; idx < len; idx++) {
-    err = esp_i2c_write_byte(buf[idx], &ack_resp);
-    if (err != ESP_I2C_OK) return esp_i2c_fail_fast(err);
-    if (ack_resp != ESP_I2C_ACK) esp_i2c_fail_fast(ESP_I2C_ERR_NO_ACK);
+    err = esp_i2c_bus_write_byte(bus, buf[idx], &ack_resp);
+    if (err != ESP_I2C_OK) return esp_i2c_bus_fail_fast(bus, err);
+    if (ack_resp != ESP_I2C_ACK) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_NO_ACK);
   }
 
   return ESP_I2C_OK;
 }
 
+/**
+ * Read byte with aligned 32 bit load.
+ *
+ * Flash mapped to address space can be read only 32 bits at a time.
+ *
+ * @param ptr The byte address.
+ *
+ * @return The byte.
+ */
+static inline uint8_t
+load_byte(const uint8_t *ptr)
+{
+  uintptr_t addr = (uintptr_t) ptr;
+  uint32_t word = *(const uint32_t *) (addr & ~(uintptr_t) 0x3);
+
+  return (uint8_t) (word >> ((addr & 0x3) * 8));
+}
+
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_read_bytes(uint8_t *buf, uint8_t len)
+esp_i2c_bus_write_iov(esp_i2c_bus *bus, const esp_i2c_iovec *iov, uint8_t num)
 {
-  uint8_t idx;
+  uint8_t seg;
+  uint16_t idx;
+  bool ack_resp;
+  esp_i2c_err err;
+
+  for (seg = 0; seg < num; seg++) {
+    for (idx = 0; idx < iov[seg].len; idx++) {
+      err = esp_i2c_bus_write_byte(bus, load_byte(&iov[seg].buf[idx]), &ack_resp);
+      if (err != ESP_I2C_OK) return esp_i2c_bus_fail_fast(bus, err);
+      if (ack_resp != ESP_I2C_ACK) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_NO_ACK);
+    }
+  }
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Read bytes from I2C bus.
+ *
+ * @param bus       The I2C bus.
+ * @param buf       The buffer to read data to.
+ * @param len       The number of bytes to read.
+ * @param nack_last Send ESP_I2C_NACK after the last byte.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+read_chunk(esp_i2c_bus *bus, uint8_t *buf, uint16_t len, bool nack_last)
+{
+  uint16_t idx;
   bool ack_type = ESP_I2C_ACK;
   esp_i2c_err err;
 
   for (idx = 0; idx < len; idx++) {
-    if (idx == len - 1) ack_type = ESP_I2C_NACK;
-    err = esp_i2c_read_byte(&buf[idx], ack_type);
-    if (err != ESP_I2C_OK) return esp_i2c_fail_fast(err);
+    if (nack_last && idx == len - 1) ack_type = ESP_I2C_NACK;
+    err = esp_i2c_bus_read_byte(bus, &buf[idx], ack_type);
+    if (err != ESP_I2C_OK) return esp_i2c_bus_fail_fast(bus, err);
   }
 
   return ESP_I2C_OK;
 }
 
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_start_read_write(uint8_t address, bool stop_on_nack)
+esp_i2c_bus_read_bytes(esp_i2c_bus *bus, uint8_t *buf, uint16_t len)
 {
-  bool ack_resp;
+  return read_chunk(bus, buf, len, true);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_write_stream(esp_i2c_bus *bus,
+                         uint8_t *chunk,
+                         uint16_t chunk_len,
+                         esp_i2c_producer producer,
+                         void *arg)
+{
+  uint16_t len;
   esp_i2c_err err;
 
-  err = esp_i2c_start();
-  if (err != ESP_I2C_OK) return err;
+  while ((len = producer(arg, chunk, chunk_len)) > 0) {
+    err = esp_i2c_bus_write_bytes(bus, chunk, len);
+    if (err != ESP_I2C_OK) return err;
+  }
 
-  err = esp_i2c_write_byte(address, &ack_resp);
-  if (err != ESP_I2C_OK) return err;
-  if (ack_resp != ESP_I2C_ACK) {
-    if (stop_on_nack) esp_i2c_stop();
-    return esp_i2c_fail_fast(ESP_I2C_ERR_NO_ACK);
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_read_stream(esp_i2c_bus *bus,
+                        uint8_t *chunk,
+                        uint16_t chunk_len,
+                        uint32_t total,
+                        esp_i2c_consumer consumer,
+                        void *arg)
+{
+  uint16_t len;
+  esp_i2c_err err;
+
+  if (chunk_len == 0 && total > 0) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_BAD_ARG);
+
+  while (total > 0) {
+    len = total > chunk_len ? chunk_len : (uint16_t) total;
+    total -= len;
+
+    err = read_chunk(bus, chunk, len, total == 0);
+    if (err != ESP_I2C_OK) return err;
+
+    consumer(arg, chunk, len);
   }
 
   return ESP_I2C_OK;
 }
 
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_start_write(uint8_t address, uint8_t reg)
+esp_i2c_bus_start_read_write(esp_i2c_bus *bus, uint8_t address, bool stop_on_nack)
 {
   bool ack_resp;
   esp_i2c_err err;
 
-  err = esp_i2c_start_read_write(ESP_I2C_ADDR_WRITE(address), true);
+  // Profile of 10 bit address is selected by esp_i2c_bus_start_ten.
+  if ((address & 0xF8) != 0xF0) esp_i2c_use_profile(bus, address >> 1);
+
+  err = esp_i2c_bus_start(bus);
   if (err != ESP_I2C_OK) return err;
 
-  err = esp_i2c_write_byte(reg, &ack_resp);
+  err = esp_i2c_bus_write_byte(bus, address, &ack_resp);
   if (err != ESP_I2C_OK) return err;
-  if (ack_resp != ESP_I2C_ACK) return esp_i2c_fail_fast(ESP_I2C_ERR_NO_ACK);
+  if (ack_resp != ESP_I2C_ACK) {
+    if (stop_on_nack) esp_i2c_bus_stop(bus);
+    return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_NO_ACK);
+  }
 
   return ESP_I2C_OK;
 }
 
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_start_read(uint8_t address, uint8_t reg)
+esp_i2c_bus_start_write(esp_i2c_bus *bus, uint8_t address, uint8_t reg)
 {
+  bool ack_resp;
   esp_i2c_err err;
 
-  err = esp_i2c_start_write(address, reg);
+  err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR_WRITE(address), true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_write_byte(bus, reg, &ack_resp);
   if (err != ESP_I2C_OK) return err;
+  if (ack_resp != ESP_I2C_ACK) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_NO_ACK);
 
-  return esp_i2c_start_read_write(ESP_I2C_ADDR_READ(address), true);
+  return ESP_I2C_OK;
 }
 
-void ICACHE_FLASH_ATTR
-esp_i2c_free_device_list(esp_i2c_dev *root, bool free_custom)
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_start_read(esp_i2c_bus *bus, uint8_t address, uint8_t reg)
 {
-  esp_i2c_dev *curr;
-  esp_i2c_dev *next = root;
+  esp_i2c_err err;
 
-  while (next != NULL) {
-    curr = next;
-    next = next->next;
-    if (free_custom && curr->custom != NULL) os_free(curr->custom);
-    os_free(curr);
-  }
+  err = esp_i2c_bus_start_write(bus, address, reg);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR_READ(address), true);
 }
 
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_scan(esp_i2c_dev **root)
+esp_i2c_bus_start_ten(esp_i2c_bus *bus, uint16_t address, bool read, bool stop_on_nack)
 {
-  uint8_t address;
+  bool ack_resp;
   esp_i2c_err err;
-  esp_i2c_dev *curr;
-
-  if (*root != NULL) return ESP_I2C_ERR_ROOT_NOT_NULL;
-  curr = *root = os_zalloc(sizeof(esp_i2c_dev));
 
-  for (address = 1; address < 128; address++) {
-    // Skip reserved addresses.
-    // 0000 0XXX
-    // 0111 1XXX
-    if ((address >> 0x3) == 0xF) continue;
-    if ((address & 0x78) == 0 && (address & 0x3) > 0) continue;
+  esp_i2c_use_profile(bus, ESP_I2C_PROFILE_TEN(address));
 
-    err = esp_i2c_start_read_write(ESP_I2C_ADDR_WRITE(address), true);
-    if (err != ESP_I2C_OK) continue;
+  // Slave selected for writing in this transaction needs only
+  // the first address byte with read bit set.
+  if (!read || !bus->in_trans || bus->ten_addr != address) {
+    err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR10_HI(address, false), stop_on_nack);
+    if (err != ESP_I2C_OK) return err;
 
-    // First found device.
-    if (curr->address == 0) {
-      curr->address = address;
-      esp_i2c_stop();
-      continue;
+    err = esp_i2c_bus_write_byte(bus, ESP_I2C_ADDR10_LO(address), &ack_resp);
+    if (err != ESP_I2C_OK) return err;
+    if (ack_resp != ESP_I2C_ACK) {
+      if (stop_on_nack) esp_i2c_bus_stop(bus);
+      return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_NO_ACK);
     }
 
-    // Add device to the list.
-    curr->next = os_zalloc(sizeof(esp_i2c_dev));
-    curr->next->address = address;
-    curr = curr->next;
-    esp_i2c_stop();
+    bus->ten_addr = address;
+    if (!read) return ESP_I2C_OK;
   }
 
-  if ((*root)->address == 0x0) {
-    esp_i2c_free_device_list(*root, false);
-    *root = NULL;
-  }
+  err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR10_HI(address, true), stop_on_nack);
+  if (err != ESP_I2C_OK) return err;
+
+  bus->ten_addr = address;
 
   return ESP_I2C_OK;
 }
+
+/**
+ * Check if message reading continues in the next message.
+ *
+ * @param msgs The array of messages.
+ * @param num  The number of messages.
+ * @param idx  The current message index.
+ *
+ * @return true if next message continues reading, false otherwise.
+ */
+static bool ICACHE_FLASH_ATTR
+read_continues(esp_i2c_msg *msgs, uint8_t num, uint8_t idx)
+{
+  uint16_t flags;
+
+  if (idx + 1 >= num) return false;
+  flags = msgs[idx + 1].flags;
+
+  return (flags & ESP_I2C_M_NOSTART) && (flags & ESP_I2C_M_RD);
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_set_retry(esp_i2c_bus *bus, uint8_t retries, uint16_t mask, uint16_t backoff_us)
+{
+  bus->retry.retries = retries;
+  bus->retry.mask = mask;
+  bus->retry.backoff_us = backoff_us;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_recover(esp_i2c_bus *bus)
+{
+  uint8_t idx;
+
+  if (bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  bus->stats.recoveries++;
+
+  SDA_RELEASE(bus);
+  SCL_RELEASE(bus);
+  if (esp_i2c_chk_cs(bus) == ESP_I2C_CS_TIMEOUT) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
+
+  // Slave finishes sending its byte and sees NACK.
+  for (idx = 0; idx < 9 && SDA_READ(bus) == ESP_I2C_LO; idx++) {
+    SCL_LOW(bus);
+    delay(bus->delay_long);
+    SCL_RELEASE(bus);
+    if (esp_i2c_chk_cs(bus) == ESP_I2C_CS_TIMEOUT) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
+    delay(bus->delay_long);
+  }
+
+  if (SDA_READ(bus) == ESP_I2C_LO) return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_BUS_STUCK);
+
+  // STOP condition resets slaves state machines.
+  SCL_LOW(bus);
+  delay(bus->delay_short);
+  SDA_LOW(bus);
+  delay(bus->delay_short);
+  SCL_RELEASE(bus);
+  delay(bus->delay_short);
+  SDA_RELEASE(bus);
+  delay(bus->delay_short);
+
+  return esp_i2c_bus_fail_fast(bus, ESP_I2C_OK);
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_reset_stats(esp_i2c_bus *bus)
+{
+  os_memset(&bus->stats, 0, sizeof(esp_i2c_stats));
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_set_crit(esp_i2c_bus *bus, uint16_t max_us)
+{
+  bus->crit_max_us = max_us;
+  bus->crit_max = max_us * system_get_cpu_freq();
+}
+
+/**
+ * Wait random time before retrying transaction.
+ *
+ * @param retry   The retry policy.
+ * @param attempt The retry number starting from 0.
+ */
+static void ICACHE_FLASH_ATTR
+backoff(const esp_i2c_retry *retry, uint8_t attempt)
+{
+  uint32_t window = (uint32_t) retry->backoff_us << (attempt < 8 ? attempt : 8);
+
+  if (window > 0xFFFF) window = 0xFFFF;
+  if (window < 2) window = 2;
+
+  os_delay_us((uint16_t) (window / 2 + os_random() % (window / 2 + 1)));
+}
+
+/**
+ * Execute list of messages once.
+ *
+ * @param bus  The I2C bus.
+ * @param msgs The array of messages.
+ * @param num  The number of messages.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+transfer_once(esp_i2c_bus *bus, esp_i2c_msg *msgs, uint8_t num)
+{
+  uint8_t idx;
+  uint16_t pos;
+  bool ack_resp;
+  bool ack_type;
+  esp_i2c_msg *msg;
+  esp_i2c_err err;
+
+  for (idx = 0; idx < num; idx++) {
+    msg = &msgs[idx];
+
+    if ((msg->flags & ESP_I2C_M_TEN) && (idx == 0 || !(msg->flags & ESP_I2C_M_NOSTART))) {
+      err = esp_i2c_bus_start_ten(bus, msg->address, (msg->flags & ESP_I2C_M_RD) != 0, true);
+      if (err != ESP_I2C_OK) return err;
+    } else if (idx == 0 || !(msg->flags & ESP_I2C_M_NOSTART)) {
+      esp_i2c_use_profile(bus, msg->address);
+      err = esp_i2c_bus_start(bus);
+      if (err != ESP_I2C_OK) return err;
+
+      if (msg->flags & ESP_I2C_M_RD) {
+        err = esp_i2c_bus_write_byte(bus, ESP_I2C_ADDR_READ(msg->address), &ack_resp);
+      } else {
+        err = esp_i2c_bus_write_byte(bus, ESP_I2C_ADDR_WRITE(msg->address), &ack_resp);
+      }
+      if (err != ESP_I2C_OK) return err;
+
+      if (ack_resp != ESP_I2C_ACK && !(msg->flags & ESP_I2C_M_IGNORE_NAK)) {
+        esp_i2c_bus_stop(bus);
+        return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_NO_ACK);
+      }
+    }
+
+    if (msg->flags & ESP_I2C_M_RD) {
+      ack_type = ESP_I2C_ACK;
+      for (pos = 0; pos < msg->len; pos++) {
+        if (pos == msg->len - 1 && !read_continues(msgs, num, idx)) ack_type = ESP_I2C_NACK;
+        err = esp_i2c_bus_read_byte(bus, &msg->buf[pos], ack_type);
+        if (err != ESP_I2C_OK) return err;
+      }
+      continue;
+    }
+
+    for (pos = 0; pos < msg->len; pos++) {
+      err = esp_i2c_bus_write_byte(bus, msg->buf[pos], &ack_resp);
+      if (err != ESP_I2C_OK) return err;
+
+      if (ack_resp != ESP_I2C_ACK && !(msg->flags & ESP_I2C_M_IGNORE_NAK)) {
+        esp_i2c_bus_stop(bus);
+        return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_NO_ACK);
+      }
+    }
+  }
+
+  return esp_i2c_bus_stop(bus);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_transfer(esp_i2c_bus *bus, esp_i2c_msg *msgs, uint8_t num)
+{
+  return esp_i2c_bus_transfer_retry(bus, msgs, num, NULL);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_transfer_retry(esp_i2c_bus *bus, esp_i2c_msg *msgs, uint8_t num, const esp_i2c_retry *retry)
+{
+  uint8_t attempt;
+  esp_i2c_err err;
+
+  if (retry == NULL) retry = &bus->retry;
+
+  for (attempt = 0;; attempt++) {
+    err = transfer_once(bus, msgs, num);
+    if (err == ESP_I2C_OK || attempt >= retry->retries) return err;
+    if (!(retry->mask & ESP_I2C_RETRY_ON(err))) return err;
+
+    bus->stats.retries++;
+    backoff(retry, attempt);
+
+    // Data line still held low after backoff means stuck slave.
+    if (SDA_READ(bus) == ESP_I2C_LO && SCL_READ(bus) == ESP_I2C_HIGH) {
+      err = esp_i2c_bus_recover(bus);
+      if (err != ESP_I2C_OK) return err;
+    }
+  }
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_free_device_list(esp_i2c_dev *root, bool free_custom)
+{
+  esp_i2c_dev *curr;
+  esp_i2c_dev *next = root;
+
+  while (next != NULL) {
+    curr = next;
+    next = next->next;
+    if (free_custom && curr->custom != NULL) os_free(curr->custom);
+    os_free(curr);
+  }
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_scan(esp_i2c_bus *bus, esp_i2c_dev **root)
+{
+  uint8_t address;
+  esp_i2c_err err;
+  esp_i2c_dev *curr;
+
+  if (*root != NULL) return ESP_I2C_ERR_ROOT_NOT_NULL;
+  curr = *root = os_zalloc(sizeof(esp_i2c_dev));
+
+  for (address = 1; address < 128; address++) {
+    // Skip reserved addresses.
+    if (ESP_I2C_ADDR_RESERVED(address)) continue;
+
+    err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR_WRITE(address), true);
+    if (err != ESP_I2C_OK) continue;
+
+    // First found device.
+    if (curr->address == 0) {
+      curr->address = address;
+      esp_i2c_bus_stop(bus);
+      continue;
+    }
+
+    // Add device to the list.
+    curr->next = os_zalloc(sizeof(esp_i2c_dev));
+    curr->next->address = address;
+    curr = curr->next;
+    esp_i2c_bus_stop(bus);
+  }
+
+  if ((*root)->address == 0x0) {
+    esp_i2c_free_device_list(*root, false);
+    *root = NULL;
+  }
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_probe(esp_i2c_bus *bus, uint8_t address)
+{
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR_WRITE(address), true);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(bus);
+}
+
+/**
+ * Switch bus speed for probing.
+ *
+ * @param bus      The I2C bus.
+ * @param probe_hz The probe speed in Hz (0 - keep current speed).
+ *
+ * @return The speed to restore after probing.
+ */
+static uint32_t ICACHE_FLASH_ATTR
+probe_speed(esp_i2c_bus *bus, uint32_t probe_hz)
+{
+  uint32_t speed = bus->default_speed;
+
+  if (probe_hz > 0 && probe_hz != speed) esp_i2c_bus_set_speed(bus, probe_hz);
+
+  return speed;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_scan_map(esp_i2c_bus *bus, esp_i2c_addr_map *found, uint32_t probe_hz)
+{
+  uint8_t address;
+  uint32_t speed;
+
+  if (bus->in_trans || bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  os_memset(found, 0, sizeof(esp_i2c_addr_map));
+  speed = probe_speed(bus, probe_hz);
+
+  for (address = 0x08; address <= 0x77; address++) {
+    if (esp_i2c_bus_probe(bus, address) == ESP_I2C_OK) ESP_I2C_MAP_SET(found, address);
+  }
+
+  esp_i2c_bus_set_speed(bus, speed);
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Read one register without retries.
+ *
+ * @param bus     The I2C bus.
+ * @param address The profile address.
+ * @param reg     The register.
+ * @param val     The register value.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+read_reg(esp_i2c_bus *bus, uint16_t address, uint8_t reg, uint8_t *val)
+{
+  static const esp_i2c_retry no_retry = {.retries = 0, .mask = 0, .backoff_us = 0};
+  uint16_t flags = ESP_I2C_PROFILE_IS_TEN(address) ? ESP_I2C_M_TEN : 0;
+  esp_i2c_msg msgs[] = {
+      {.address = (uint16_t) (address & 0x3FF), .flags = flags, .len = 1, .buf = &reg},
+      {.address = (uint16_t) (address & 0x3FF), .flags = (uint16_t) (flags | ESP_I2C_M_RD), .len = 1, .buf = val},
+  };
+
+  return esp_i2c_bus_transfer_retry(bus, msgs, 2, &no_retry);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_discover_speed(esp_i2c_bus *bus, uint16_t address, uint8_t reg, const uint32_t *speeds, uint8_t num)
+{
+  static const uint32_t default_speeds[] = {
+      ESP_I2C_SPEED_200, ESP_I2C_SPEED_300, ESP_I2C_SPEED_400, ESP_I2C_SPEED_1000};
+  uint8_t idx;
+  uint8_t check;
+  uint8_t ref;
+  uint8_t val;
+  uint32_t top;
+  uint32_t speed;
+  uint32_t good;
+  esp_i2c_profile *profile;
+  esp_i2c_err err;
+
+  if (bus->in_trans || bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  esp_i2c_use_profile(bus, address);
+  profile = bus->profile;
+  if (profile == NULL) return ESP_I2C_ERR_BAD_ARG;
+
+  if (speeds == NULL) {
+    speeds = default_speeds;
+    num = sizeof(default_speeds) / sizeof(default_speeds[0]);
+  }
+
+  // Reference value read at standard speed.
+  profile->speed = ESP_I2C_SPEED_100;
+  err = read_reg(bus, address, reg, &ref);
+  if (err != ESP_I2C_OK) return err;
+
+  // Faster speeds give the same bit timing as the fastest one.
+  top = max_speed(bus);
+  good = ESP_I2C_SPEED_100;
+
+  for (idx = 0; idx < num; idx++) {
+    speed = top > 0 && speeds[idx] > top ? top : speeds[idx];
+    if (speed <= good) continue;
+    profile->speed = speed;
+
+    for (check = 0; check < ESP_I2C_SPEED_CHECKS; check++) {
+      err = read_reg(bus, address, reg, &val);
+      if (err != ESP_I2C_OK || val != ref) break;
+    }
+
+    // Other master or stuck bus says nothing about the speed.
+    if (err == ESP_I2C_ERR_ARB_LOST || err == ESP_I2C_ERR_BUS_STUCK) {
+      profile->speed = good;
+      esp_i2c_use_profile(bus, address);
+      return err;
+    }
+    if (check < ESP_I2C_SPEED_CHECKS) break;
+
+    good = speed;
+  }
+
+  profile->speed = good;
+
+  // Device confused by too fast clock may hold SDA low.
+  if (SDA_READ(bus) == ESP_I2C_LO) esp_i2c_bus_recover(bus);
+
+  esp_i2c_use_profile(bus, address);
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_probe_ten(esp_i2c_bus *bus, uint16_t address)
+{
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_start_ten(bus, address, false, true);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(bus);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_scan_ten(esp_i2c_bus *bus, esp_i2c_ten_map *found, uint32_t probe_hz)
+{
+  uint16_t address;
+  uint32_t speed;
+
+  if (bus->in_trans || bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  os_memset(found, 0, sizeof(esp_i2c_ten_map));
+  speed = probe_speed(bus, probe_hz);
+
+  for (address = 0; address < 1024; address++) {
+    // Skip whole range if no slave acknowledges the first address byte.
+    if ((address & 0xFF) == 0 && esp_i2c_bus_probe(bus, ESP_I2C_ADDR10_HI(address, false) >> 1) != ESP_I2C_OK) {
+      address += 0xFF;
+      continue;
+    }
+
+    if (esp_i2c_bus_probe_ten(bus, address) == ESP_I2C_OK) ESP_I2C_MAP_SET(found, address);
+  }
+
+  esp_i2c_bus_set_speed(bus, speed);
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_rescan(esp_i2c_bus *bus, esp_i2c_rescan *rs)
+{
+  uint8_t address;
+  uint8_t probed = 0;
+  uint32_t speed;
+
+  if (bus->in_trans || bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  os_memset(&rs->added, 0, sizeof(esp_i2c_addr_map));
+  os_memset(&rs->removed, 0, sizeof(esp_i2c_addr_map));
+  speed = probe_speed(bus, rs->probe_hz);
+
+  // Check devices we know about.
+  for (address = 0x08; address <= 0x77; address++) {
+    if (!ESP_I2C_MAP_HAS(&rs->present, address)) continue;
+    if (esp_i2c_bus_probe(bus, address) == ESP_I2C_OK) continue;
+
+    ESP_I2C_MAP_CLR(&rs->present, address);
+    ESP_I2C_MAP_SET(&rs->removed, address);
+  }
+
+  // Look for new devices in the window of not present addresses.
+  while (probed < rs->window && probed < 128) {
+    address = rs->cursor;
+    rs->cursor = (uint8_t) ((rs->cursor + 1) & 0x7F);
+    probed++;
+
+    if (ESP_I2C_ADDR_RESERVED(address)) continue;
+    if (ESP_I2C_MAP_HAS(&rs->present, address)) continue;
+    if (ESP_I2C_MAP_HAS(&rs->removed, address)) continue;
+    if (esp_i2c_bus_probe(bus, address) != ESP_I2C_OK) continue;
+
+    ESP_I2C_MAP_SET(&rs->present, address);
+    ESP_I2C_MAP_SET(&rs->added, address);
+  }
+
+  esp_i2c_bus_set_speed(bus, speed);
+
+  return ESP_I2C_OK;
+}
+
+// Functions advancing asynchronous engine by one tick are not marked
+// with ICACHE_FLASH_ATTR so they are placed in IRAM and may run from
+// hardware timer interrupt handler (see esp_i2c_bus_async_isr_step).
+
+/**
+ * Finish asynchronous transaction on fatal error.
+ *
+ * @param trans The transaction.
+ * @param err   The I2C error code.
+ *
+ * @return Always true.
+ */
+static bool
+async_fail(esp_i2c_async *trans, esp_i2c_err err)
+{
+  trans->err = esp_i2c_bus_fail_fast(trans->bus, err);
+  trans->state = ESP_I2C_AS_IDLE;
+
+  return true;
+}
+
+/**
+ * Check how long slave is stretching the clock.
+ *
+ * The engine does not wait for the slave, it checks the clock
+ * again on the next tick so long stretches do not block the CPU.
+ *
+ * @param trans The transaction.
+ *
+ * @return true if stretching took too long, false otherwise.
+ */
+static bool
+async_stretch(esp_i2c_async *trans)
+{
+  esp_i2c_bus *bus = trans->bus;
+
+  trans->cs_seen = true;
+  if (get_ccount() - trans->cs_start < bus->max_cs) return false;
+
+  bus->stats.cs_timeouts++;
+
+  return async_fail(trans, ESP_I2C_ERR_LONG_STRETCH);
+}
+
+/**
+ * Account clock stretch after slave released the clock.
+ *
+ * @param trans The transaction.
+ */
+static void
+async_stretch_end(esp_i2c_async *trans)
+{
+  esp_i2c_bus *bus = trans->bus;
+
+  // Clock released before the next tick is not stretched.
+  if (!trans->cs_seen) return;
+
+  trans->cs_seen = false;
+  cs_account(bus, (get_ccount() - trans->cs_start) / bus->cpu_mhz);
+}
+
+/**
+ * Move transaction to STOP state.
+ *
+ * @param trans The transaction.
+ *
+ * @return Always false.
+ */
+static bool
+async_goto_stop(esp_i2c_async *trans)
+{
+  trans->state = ESP_I2C_AS_STOP;
+  trans->phase = 0;
+
+  return false;
+}
+
+/**
+ * START or repeated START condition.
+ *
+ * Followed by the slave address with read / write bit set.
+ *
+ * @param trans The transaction.
+ *
+ * @return true when transaction is finished, false otherwise.
+ */
+static bool
+async_start(esp_i2c_async *trans)
+{
+  esp_i2c_bus *bus = trans->bus;
+
+  switch (trans->phase) {
+    case 0:
+      // For repeated START we are in the middle of low clock cycle.
+      SDA_RELEASE(bus);
+      SCL_RELEASE(bus);
+      trans->cs_start = get_ccount();
+      trans->phase = 1;
+      return false;
+
+    case 1:
+      if (SCL_READ(bus) == ESP_I2C_LO) return async_stretch(trans);
+      async_stretch_end(trans);
+      if (SDA_READ(bus) == ESP_I2C_LO) {
+        // SDA held low before START is a bus fault.
+        if (!bus->in_trans) return async_fail(trans, ESP_I2C_ERR_BUS_STUCK);
+        return async_fail(trans, arb_lost(bus));
+      }
+
+      // Drive SDA low while SCL is high.
+      SDA_LOW(bus);
+      trans->phase = 2;
+      return false;
+
+    default:
+      SCL_LOW(bus);
+      bus->in_trans = true;
+
+      trans->state = ESP_I2C_AS_WRITE;
+      trans->phase = 0;
+      trans->idx = -1;
+      trans->mask = 0x80;
+      if (trans->reading) {
+        trans->byte = ESP_I2C_ADDR_READ(trans->address);
+      } else {
+        trans->byte = ESP_I2C_ADDR_WRITE(trans->address);
+      }
+      return false;
+  }
+}
+
+/**
+ * Decide what to do after ACK bit.
+ *
+ * @param trans The transaction.
+ *
+ * @return true when transaction is finished, false otherwise.
+ */
+static bool
+async_next_byte(esp_i2c_async *trans)
+{
+  trans->mask = 0x80;
+  trans->idx++;
+
+  if (trans->state == ESP_I2C_AS_READ) {
+    if (trans->idx < trans->rd_len) {
+      trans->byte = 0;
+      return false;
+    }
+    return async_goto_stop(trans);
+  }
+
+  if (trans->ack != ESP_I2C_ACK) {
+    trans->err = ESP_I2C_ERR_NO_ACK;
+    return async_goto_stop(trans);
+  }
+
+  // Slave acknowledged address with read bit set.
+  if (trans->reading) {
+    trans->state = ESP_I2C_AS_READ;
+    trans->idx = 0;
+    trans->byte = 0;
+    return false;
+  }
+
+  if (trans->idx < trans->wr_len) {
+    trans->byte = trans->wr_buf[trans->idx];
+    return false;
+  }
+
+  if (trans->rd_len > 0) {
+    trans->reading = true;
+    trans->state = ESP_I2C_AS_START;
+    trans->phase = 0;
+    return false;
+  }
+
+  return async_goto_stop(trans);
+}
+
+/**
+ * One quarter of data or ACK bit.
+ *
+ * Bit phases:
+ *   0 - set SDA while SCL is low,
+ *   1 - release SCL,
+ *   2 - wait for clock stretching and sample SDA,
+ *   3 - drive SCL low.
+ *
+ * @param trans The transaction.
+ *
+ * @return true when transaction is finished, false otherwise.
+ */
+static bool
+async_bit(esp_i2c_async *trans)
+{
+  esp_i2c_bus *bus = trans->bus;
+  bool bit;
+
+  switch (trans->phase) {
+    case 0:
+      if (trans->state == ESP_I2C_AS_WRITE) {
+        // Release SDA for slave to ACK.
+        bit = trans->mask ? (trans->byte & trans->mask) != 0 : true;
+      } else {
+        // Release SDA for slave to send data.
+        bit = trans->mask ? true : trans->ack;
+      }
+      bit ? SDA_RELEASE(bus) : SDA_LOW(bus);
+      trans->phase = 1;
+      return false;
+
+    case 1:
+      SCL_RELEASE(bus);
+      trans->cs_start = get_ccount();
+      trans->phase = 2;
+      return false;
+
+    case 2:
+      if (SCL_READ(bus) == ESP_I2C_LO) return async_stretch(trans);
+      async_stretch_end(trans);
+
+      bit = SDA_READ(bus);
+      if (trans->state == ESP_I2C_AS_WRITE && trans->mask && (trans->byte & trans->mask) && !bit) {
+        return async_fail(trans, arb_lost(bus));
+      }
+      if (trans->mask == 0) {
+        if (trans->state == ESP_I2C_AS_WRITE) trans->ack = bit;
+      } else if (trans->state == ESP_I2C_AS_READ && bit) {
+        trans->byte |= trans->mask;
+      }
+      trans->phase = 3;
+      return false;
+
+    default:
+      SCL_LOW(bus);
+      trans->phase = 0;
+
+      if (trans->mask == 0) return async_next_byte(trans);
+
+      trans->mask >>= 1;
+      if (trans->mask == 0 && trans->state == ESP_I2C_AS_READ) {
+        trans->rd_buf[trans->idx] = trans->byte;
+        // ESP_I2C_NACK is send after last byte.
+        trans->ack = (trans->idx == trans->rd_len - 1) ? ESP_I2C_NACK : ESP_I2C_ACK;
+      }
+      return false;
+  }
+}
+
+/**
+ * STOP condition.
+ *
+ * @param trans The transaction.
+ *
+ * @return true when transaction is finished, false otherwise.
+ */
+static bool
+async_stop(esp_i2c_async *trans)
+{
+  esp_i2c_bus *bus = trans->bus;
+
+  switch (trans->phase) {
+    case 0:
+      SDA_LOW(bus);
+      trans->phase = 1;
+      return false;
+
+    case 1:
+      SCL_RELEASE(bus);
+      trans->cs_start = get_ccount();
+      trans->phase = 2;
+      return false;
+
+    default:
+      if (SCL_READ(bus) == ESP_I2C_LO) return async_stretch(trans);
+      async_stretch_end(trans);
+
+      SDA_RELEASE(bus);
+      bus->in_trans = false;
+      trans->state = ESP_I2C_AS_IDLE;
+      return true;
+  }
+}
+
+/**
+ * Advance transaction by one tick.
+ *
+ * @param trans The transaction.
+ *
+ * @return true when transaction is finished, false otherwise.
+ */
+static bool
+async_tick(esp_i2c_async *trans)
+{
+  switch (trans->state) {
+    case ESP_I2C_AS_START:
+      return async_start(trans);
+
+    case ESP_I2C_AS_WRITE:
+    case ESP_I2C_AS_READ:
+      return async_bit(trans);
+
+    case ESP_I2C_AS_STOP:
+      return async_stop(trans);
+
+    default:
+      return true;
+  }
+}
+
+/**
+ * Prepare transaction for execution.
+ *
+ * The device profile is selected here so ticks do not call the SDK.
+ *
+ * @param trans The transaction.
+ */
+static void ICACHE_FLASH_ATTR
+async_begin(esp_i2c_async *trans)
+{
+  esp_i2c_use_profile(trans->bus, trans->address);
+
+  trans->phase = 0;
+  trans->reading = (trans->wr_len == 0 && trans->rd_len > 0);
+  trans->cs_seen = false;
+  trans->err = ESP_I2C_OK;
+  trans->busy_cycles = 0;
+  trans->total_cycles = get_ccount();
+  trans->state = ESP_I2C_AS_START;
+}
+
+/**
+ * Make transaction the head of the queue.
+ *
+ * The interrupt step may run any time so the transaction is fully
+ * prepared before it becomes visible to it.
+ *
+ * @param bus   The I2C bus.
+ * @param trans The transaction or NULL.
+ */
+static void ICACHE_FLASH_ATTR
+async_set_head(esp_i2c_bus *bus, esp_i2c_async *trans)
+{
+  if (trans != NULL) async_begin(trans);
+  bus->async_posted = false;
+
+  // Keep compiler from moving stores above after the head update.
+  __asm__ __volatile__("" : : : "memory");
+  bus->async_head = trans;
+}
+
+/**
+ * Remove finished transaction from the queue and notify the caller.
+ *
+ * @param trans The finished transaction.
+ */
+static void ICACHE_FLASH_ATTR
+async_done(esp_i2c_async *trans)
+{
+  esp_i2c_bus *bus = trans->bus;
+  esp_i2c_async *next = trans->next;
+
+  trans->next = NULL;
+  trans->total_cycles = get_ccount() - trans->total_cycles;
+
+  if (next == NULL) {
+    bus->async_tail = NULL;
+    if (bus->async_tick_us > 0) os_timer_disarm(&bus->async_timer);
+  }
+  async_set_head(bus, next);
+
+  if (trans->cb != NULL) trans->cb(trans, trans->err);
+}
+
+static void ICACHE_FLASH_ATTR
+async_timer_cb(void *arg)
+{
+  esp_i2c_bus_async_step((esp_i2c_bus *) arg);
+}
+
+/**
+ * Finish transaction stepped from interrupt handler.
+ *
+ * @param event The event with the I2C bus as parameter.
+ */
+static void ICACHE_FLASH_ATTR
+async_task(os_event_t *event)
+{
+  esp_i2c_bus *bus = (esp_i2c_bus *) event->par;
+  esp_i2c_async *trans = bus->async_head;
+
+  if (trans != NULL && trans->state == ESP_I2C_AS_IDLE) async_done(trans);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_async_set_tick(esp_i2c_bus *bus, uint32_t tick_us)
+{
+  if (tick_us > 0 && tick_us < ESP_I2C_ASYNC_MIN_TICK_US) return ESP_I2C_ERR_BAD_ARG;
+
+  bus->async_tick_us = tick_us;
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_async_submit(esp_i2c_bus *bus, esp_i2c_async *trans)
+{
+  // Synchronous transaction in progress.
+  if (bus->in_trans && bus->async_head == NULL) return ESP_I2C_ERR_BUSY;
+
+  trans->bus = bus;
+  trans->next = NULL;
+
+  if (bus->async_head != NULL) {
+    bus->async_tail->next = trans;
+    bus->async_tail = trans;
+    return ESP_I2C_OK;
+  }
+
+  bus->async_tail = trans;
+  async_set_head(bus, trans);
+
+  if (bus->async_tick_us > 0) {
+    os_timer_disarm(&bus->async_timer);
+    os_timer_setfn(&bus->async_timer, async_timer_cb, bus);
+    ets_timer_arm_new(&bus->async_timer, bus->async_tick_us, true, false);
+  }
+
+  return ESP_I2C_OK;
+}
+
+bool ICACHE_FLASH_ATTR
+esp_i2c_bus_async_step(esp_i2c_bus *bus)
+{
+  bool done;
+  uint32_t start;
+  esp_i2c_async *trans = bus->async_head;
+
+  if (trans == NULL) return false;
+
+  start = get_ccount();
+  done = async_tick(trans);
+  trans->busy_cycles += get_ccount() - start;
+  if (done) async_done(trans);
+
+  return bus->async_head != NULL;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_async_isr_init(uint8_t prio)
+{
+  if (!system_os_task(async_task, prio, async_queue, ESP_I2C_ASYNC_QUEUE)) return ESP_I2C_ERR_BAD_ARG;
+
+  async_prio = prio;
+
+  return ESP_I2C_OK;
+}
+
+bool
+esp_i2c_bus_async_isr_step(esp_i2c_bus *bus)
+{
+  bool done;
+  uint32_t start;
+  esp_i2c_async *trans = bus->async_head;
+
+  if (trans == NULL) return false;
+
+  // Finished transaction waits for the task. Post again
+  // if the task queue was full.
+  if (trans->state == ESP_I2C_AS_IDLE) {
+    if (!bus->async_posted) bus->async_posted = system_os_post(async_prio, 0, (os_param_t) bus);
+    return false;
+  }
+
+  start = get_ccount();
+  done = async_tick(trans);
+  trans->busy_cycles += get_ccount() - start;
+  if (!done) return true;
+
+  // Finished transaction is left in ESP_I2C_AS_IDLE state.
+  bus->async_posted = system_os_post(async_prio, 0, (os_param_t) bus);
+
+  return false;
+}
+
+bool ICACHE_FLASH_ATTR
+esp_i2c_bus_async_busy(esp_i2c_bus *bus)
+{
+  return bus->async_head != NULL;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_init(uint8_t scl_gpio_num, uint8_t sda_gpio_num)
+{
+  // Check double initialization.
+  if (init) {
+    if (default_bus.gpio_scl == scl_gpio_num && default_bus.gpio_sda == sda_gpio_num) return ESP_I2C_OK;
+    else return ESP_I2C_ERR_INIT_CONFLICT;
+  }
+
+  init = true;
+
+  return esp_i2c_bus_init(&default_bus, scl_gpio_num, sda_gpio_num);
+}
+
+esp_i2c_bus *ICACHE_FLASH_ATTR
+esp_i2c_default_bus()
+{
+  return &default_bus;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_set_speed(uint32_t freq_hz)
+{
+  return esp_i2c_bus_set_speed(&default_bus, freq_hz);
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_set_max_stretch(uint32_t max_us)
+{
+  esp_i2c_bus_set_max_stretch(&default_bus, max_us);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_calibrate(uint32_t *scl_hz)
+{
+  return esp_i2c_bus_calibrate(&default_bus, scl_hz);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_start()
+{
+  return esp_i2c_bus_start(&default_bus);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_stop()
+{
+  return esp_i2c_bus_stop(&default_bus);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_fail_fast(esp_i2c_err err)
+{
+  return esp_i2c_bus_fail_fast(&default_bus, err);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_write_byte(uint8_t byte, bool *ack_resp)
+{
+  return esp_i2c_bus_write_byte(&default_bus, byte, ack_resp);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_read_byte(uint8_t *dst, bool ack_type)
+{
+  return esp_i2c_bus_read_byte(&default_bus, dst, ack_type);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_write_bytes(uint8_t *buf, uint16_t len)
+{
+  return esp_i2c_bus_write_bytes(&default_bus, buf, len);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_read_bytes(uint8_t *buf, uint16_t len)
+{
+  return esp_i2c_bus_read_bytes(&default_bus, buf, len);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_start_read_write(uint8_t address, bool stop_on_nack)
+{
+  return esp_i2c_bus_start_read_write(&default_bus, address, stop_on_nack);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_start_write(uint8_t address, uint8_t reg)
+{
+  return esp_i2c_bus_start_write(&default_bus, address, reg);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_start_read(uint8_t address, uint8_t reg)
+{
+  return esp_i2c_bus_start_read(&default_bus, address, reg);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_transfer(esp_i2c_msg *msgs, uint8_t num)
+{
+  return esp_i2c_bus_transfer(&default_bus, msgs, num);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_scan(esp_i2c_dev **root)
+{
+  return esp_i2c_bus_scan(&default_bus, root);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_async_set_tick(uint32_t tick_us)
+{
+  return esp_i2c_bus_async_set_tick(&default_bus, tick_us);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_async_submit(esp_i2c_async *trans)
+{
+  return esp_i2c_bus_async_submit(&default_bus, trans);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_i2c_async_step()
+{
+  return esp_i2c_bus_async_step(&default_bus);
+}
+
+bool
+esp_i2c_async_isr_step()
+{
+  return esp_i2c_bus_async_isr_step(&default_bus);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_i2c_async_busy()
+{
+  return esp_i2c_bus_async_busy(&default_bus);
+}
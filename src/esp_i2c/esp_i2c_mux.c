@@ -0,0 +1,335 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_i2c_mux.h>
+
+
+/**
+ * Write multiplexer control register.
+ *
+ * @param bus     The I2C bus.
+ * @param address The multiplexer address.
+ * @param ctrl    The control register value.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+mux_write(esp_i2c_bus *bus, uint8_t address, uint8_t ctrl)
+{
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR_WRITE(address), true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_write_bytes(bus, &ctrl, 1);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(bus);
+}
+
+/**
+ * Read multiplexer control register.
+ *
+ * @param bus     The I2C bus.
+ * @param address The multiplexer address.
+ * @param ctrl    The control register value.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+mux_read(esp_i2c_bus *bus, uint8_t address, uint8_t *ctrl)
+{
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR_READ(address), true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_read_bytes(bus, ctrl, 1);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(bus);
+}
+
+/**
+ * Set multiplexer control register unless it is already set.
+ *
+ * @param mux  The multiplexer.
+ * @param ctrl The control register value.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+mux_set(esp_i2c_mux *mux, uint8_t ctrl)
+{
+  esp_i2c_err err;
+
+  if (mux->parent != NULL) {
+    err = esp_i2c_mux_select(mux->parent, mux->parent_channel);
+    if (err != ESP_I2C_OK) return err;
+  }
+
+  if (mux->cached && mux->ctrl == ctrl) {
+    mux->skipped++;
+    return ESP_I2C_OK;
+  }
+
+  err = mux_write(mux->bus, mux->address, ctrl);
+  if (err != ESP_I2C_OK) {
+    mux->cached = false;
+    return err;
+  }
+
+  mux->ctrl = ctrl;
+  mux->cached = true;
+  mux->switches++;
+
+  return ESP_I2C_OK;
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_mux_init(esp_i2c_mux *mux, esp_i2c_bus *bus, uint8_t address, esp_i2c_mux *parent, uint8_t parent_channel)
+{
+  os_memset(mux, 0, sizeof(esp_i2c_mux));
+
+  mux->bus = bus;
+  mux->address = address;
+  mux->parent = parent;
+  mux->parent_channel = parent_channel;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_select(esp_i2c_mux *mux, uint8_t channel)
+{
+  if (channel >= ESP_I2C_MUX_CHANNELS) return ESP_I2C_ERR_BAD_ARG;
+
+  return mux_set(mux, (uint8_t) (0x1 << channel));
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_disable(esp_i2c_mux *mux)
+{
+  return mux_set(mux, 0);
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_mux_invalidate(esp_i2c_mux *mux)
+{
+  mux->cached = false;
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_mux_topo_init(esp_i2c_mux_topo *topo,
+                      esp_i2c_bus *bus,
+                      esp_i2c_mux *muxes,
+                      uint8_t muxes_max,
+                      esp_i2c_mux_dev *devs,
+                      uint16_t devs_max)
+{
+  topo->bus = bus;
+  topo->muxes = muxes;
+  topo->muxes_max = muxes_max;
+  topo->muxes_num = 0;
+  topo->devs = devs;
+  topo->devs_max = devs_max;
+  topo->devs_num = 0;
+  topo->mux_mask = 0;
+}
+
+/**
+ * Check if device is a multiplexer by writing and reading
+ * back its control register. Leaves all channels disabled.
+ *
+ * Only addresses declared by the caller are probed so other
+ * devices in the range are never written.
+ *
+ * @param topo    The topology.
+ * @param address The device address.
+ *
+ * @return true if device is a multiplexer, false otherwise.
+ */
+static bool ICACHE_FLASH_ATTR
+is_mux(esp_i2c_mux_topo *topo, uint8_t address)
+{
+  uint8_t ctrl;
+  esp_i2c_bus *bus = topo->bus;
+
+  if (address < ESP_I2C_MUX_ADDR_MIN || address > ESP_I2C_MUX_ADDR_MAX) return false;
+  if (!(topo->mux_mask & ESP_I2C_MUX_ADDR_BIT(address))) return false;
+
+  if (mux_write(bus, address, 0x01) != ESP_I2C_OK) return false;
+  if (mux_read(bus, address, &ctrl) != ESP_I2C_OK || ctrl != 0x01) return false;
+  if (mux_write(bus, address, 0x00) != ESP_I2C_OK) return false;
+  if (mux_read(bus, address, &ctrl) != ESP_I2C_OK || ctrl != 0x00) return false;
+
+  return true;
+}
+
+/**
+ * Scan one level of the topology.
+ *
+ * The path to the level must be selected.
+ *
+ * @param topo     The topology.
+ * @param parent   The multiplexer the level is behind or NULL.
+ * @param channel  The multiplexer channel.
+ * @param upstream The addresses visible upstream.
+ * @param depth    The level depth.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+scan_level(esp_i2c_mux_topo *topo, esp_i2c_mux *parent, uint8_t channel, esp_i2c_addr_map *upstream, uint8_t depth)
+{
+  uint8_t idx;
+  uint8_t first;
+  uint8_t address;
+  esp_i2c_mux *mux;
+  esp_i2c_mux_dev *dev;
+  esp_i2c_addr_map found;
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_scan_map(topo->bus, &found, 0);
+  if (err != ESP_I2C_OK) return err;
+
+  first = topo->muxes_num;
+
+  for (address = 0x08; address <= 0x77; address++) {
+    if (!ESP_I2C_MAP_HAS(&found, address) || ESP_I2C_MAP_HAS(upstream, address)) continue;
+
+    if (depth < ESP_I2C_MUX_MAX_DEPTH && is_mux(topo, address)) {
+      if (topo->muxes_num == topo->muxes_max) return ESP_I2C_ERR_MEM;
+      mux = &topo->muxes[topo->muxes_num++];
+      esp_i2c_mux_init(mux, topo->bus, address, parent, channel);
+      mux->cached = true; // Disabled by is_mux.
+      continue;
+    }
+
+    if (topo->devs_num == topo->devs_max) return ESP_I2C_ERR_MEM;
+    dev = &topo->devs[topo->devs_num++];
+    dev->mux = parent;
+    dev->channel = channel;
+    dev->address = address;
+  }
+
+  // Everything on this level is visible on the levels below.
+  for (idx = 0; idx < 4; idx++) found.map[idx] |= upstream->map[idx];
+
+  for (idx = first; idx < topo->muxes_num; idx++) {
+    mux = &topo->muxes[idx];
+
+    for (channel = 0; channel < ESP_I2C_MUX_CHANNELS; channel++) {
+      err = esp_i2c_mux_select(mux, channel);
+      if (err != ESP_I2C_OK) return err;
+
+      err = scan_level(topo, mux, channel, &found, (uint8_t) (depth + 1));
+      if (err != ESP_I2C_OK) return err;
+    }
+
+    err = esp_i2c_mux_disable(mux);
+    if (err != ESP_I2C_OK) return err;
+  }
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_scan(esp_i2c_mux_topo *topo, uint8_t mux_mask)
+{
+  esp_i2c_addr_map upstream;
+
+  os_memset(&upstream, 0, sizeof(esp_i2c_addr_map));
+  topo->muxes_num = 0;
+  topo->devs_num = 0;
+  topo->mux_mask = mux_mask;
+
+  return scan_level(topo, NULL, 0, &upstream, 0);
+}
+
+/**
+ * Disable multiplexers on one level except one.
+ *
+ * @param topo    The topology.
+ * @param parent  The multiplexer the level is behind or NULL.
+ * @param channel The multiplexer channel.
+ * @param keep    The multiplexer to leave alone or NULL.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+quiet_level(esp_i2c_mux_topo *topo, esp_i2c_mux *parent, uint8_t channel, esp_i2c_mux *keep)
+{
+  uint8_t idx;
+  esp_i2c_mux *mux;
+  esp_i2c_err err;
+
+  for (idx = 0; idx < topo->muxes_num; idx++) {
+    mux = &topo->muxes[idx];
+    if (mux == keep || mux->parent != parent) continue;
+    if (parent != NULL && mux->parent_channel != channel) continue;
+
+    err = esp_i2c_mux_disable(mux);
+    if (err != ESP_I2C_OK) return err;
+  }
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_dev_select(esp_i2c_mux_topo *topo, esp_i2c_mux_dev *dev)
+{
+  uint8_t depth = 0;
+  uint8_t channel;
+  esp_i2c_mux *path[ESP_I2C_MUX_MAX_DEPTH];
+  esp_i2c_mux *parent = NULL;
+  esp_i2c_mux *mux;
+  esp_i2c_err err;
+
+  // Path from the device up to the bus.
+  for (mux = dev->mux; mux != NULL; mux = mux->parent) {
+    if (depth == ESP_I2C_MUX_MAX_DEPTH) return ESP_I2C_ERR_BAD_ARG;
+    path[depth++] = mux;
+  }
+
+  // Walk down selecting the path and disabling other multiplexers
+  // on each level so only one path is active.
+  channel = 0;
+  while (depth > 0) {
+    mux = path[--depth];
+
+    err = quiet_level(topo, parent, channel, mux);
+    if (err != ESP_I2C_OK) return err;
+
+    channel = depth > 0 ? path[depth - 1]->parent_channel : dev->channel;
+    err = esp_i2c_mux_select(mux, channel);
+    if (err != ESP_I2C_OK) return err;
+
+    parent = mux;
+  }
+
+  return quiet_level(topo, parent, channel, NULL);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_transfer(esp_i2c_mux_topo *topo, esp_i2c_mux_dev *dev, esp_i2c_msg *msgs, uint8_t num)
+{
+  esp_i2c_err err;
+
+  err = esp_i2c_mux_dev_select(topo, dev);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_transfer(topo->bus, msgs, num);
+}
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_i2c_par.h>
+#include "esp_i2c_priv.h"
+
+
+// Drive all lanes low.
+#define PAR_SDA_LOW(par) (GPIO_OUT_EN_S = (par)->sda_mask)
+// Release all lanes.
+#define PAR_SDA_RELEASE(par) (GPIO_OUT_EN_C = (par)->sda_mask)
+
+/**
+ * Release SCL and all lanes on fatal error.
+ *
+ * @param par The parallel I2C.
+ * @param err The I2C error code to return.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+par_fail_fast(esp_i2c_par *par, esp_i2c_err err)
+{
+  PAR_SDA_RELEASE(par);
+
+  return esp_i2c_bus_fail_fast(par->bus, err);
+}
+
+/**
+ * Count lost arbitration and release SCL and all lanes.
+ *
+ * @param par The parallel I2C.
+ *
+ * @return Always ESP_I2C_ERR_ARB_LOST.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+par_arb_lost(esp_i2c_par *par)
+{
+  par->bus->stats.arb_lost++;
+
+  return par_fail_fast(par, ESP_I2C_ERR_ARB_LOST);
+}
+
+/**
+ * Release SCL and wait for clock stretching.
+ *
+ * @param par The parallel I2C.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ESP_I2C_BIT_ATTR
+par_scl_high(esp_i2c_par *par)
+{
+  esp_i2c_bus *bus = par->bus;
+
+  SCL_RELEASE(bus);
+  if (esp_i2c_chk_cs(bus) == ESP_I2C_CS_TIMEOUT) return par_fail_fast(par, ESP_I2C_ERR_LONG_STRETCH);
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Send START or repeated START on all lanes.
+ *
+ * @param par The parallel I2C.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+par_start(esp_i2c_par *par)
+{
+  esp_i2c_bus *bus = par->bus;
+  esp_i2c_err err;
+
+  PAR_SDA_RELEASE(par);
+  delay(bus->delay_short);
+
+  err = par_scl_high(par);
+  if (err != ESP_I2C_OK) return err;
+
+  // Check for arbitration on every lane. SDA held low before
+  // the first START is a bus fault, nobody could win it.
+  if ((GPIO_IN & par->sda_mask) != par->sda_mask) {
+    if (!bus->in_trans) return par_fail_fast(par, ESP_I2C_ERR_BUS_STUCK);
+    return par_arb_lost(par);
+  }
+
+  delay(bus->delay_short);
+  PAR_SDA_LOW(par);
+  delay(bus->delay_short);
+  SCL_LOW(bus);
+  delay(bus->delay_short);
+  PAR_SDA_RELEASE(par);
+
+  bus->in_trans = true;
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Send STOP on all lanes.
+ *
+ * @param par The parallel I2C.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+par_stop(esp_i2c_par *par)
+{
+  esp_i2c_bus *bus = par->bus;
+  esp_i2c_err err;
+
+  PAR_SDA_LOW(par);
+  delay(bus->delay_short);
+
+  err = par_scl_high(par);
+  if (err != ESP_I2C_OK) return err;
+
+  delay(bus->delay_short);
+  PAR_SDA_RELEASE(par);
+  delay(bus->delay_short);
+
+  bus->in_trans = false;
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Clock one bit on all lanes.
+ *
+ * @param par The parallel I2C.
+ * @param bit The bit to drive on all lanes (true releases SDA).
+ * @param in  The GPIO_IN register value sampled while SCL was high.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ESP_I2C_BIT_ATTR
+par_bit(esp_i2c_par *par, bool bit, uint32_t *in)
+{
+  esp_i2c_bus *bus = par->bus;
+  esp_i2c_err err;
+
+  bit ? PAR_SDA_RELEASE(par) : PAR_SDA_LOW(par);
+  delay(bus->delay_short);
+
+  err = par_scl_high(par);
+  if (err != ESP_I2C_OK) return err;
+
+  delay(bus->delay_short);
+  *in = GPIO_IN;
+  delay(bus->delay_short);
+
+  SCL_LOW(bus);
+  delay(bus->delay_short);
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Write the same byte to all lanes.
+ *
+ * @param par  The parallel I2C.
+ * @param byte The byte to write.
+ * @param acks The bitmask of lanes. Lanes which did not acknowledge are cleared.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ESP_I2C_BIT_ATTR
+par_write_byte(esp_i2c_par *par, uint8_t byte, uint8_t *acks)
+{
+  uint8_t mask;
+  uint8_t lane;
+  uint32_t in;
+  esp_i2c_err err;
+
+  for (mask = 0x80; mask; mask >>= 1) {
+    err = par_bit(par, (byte & mask) != 0, &in);
+    if (err != ESP_I2C_OK) return err;
+
+    // Every lane released for 1 must read high or other master won.
+    if ((byte & mask) && (in & par->sda_mask) != par->sda_mask) return par_arb_lost(par);
+  }
+
+  err = par_bit(par, ESP_I2C_NACK, &in);
+  if (err != ESP_I2C_OK) return err;
+
+  for (lane = 0; lane < par->lanes; lane++) {
+    if (in & par->lane_mask[lane]) *acks &= ~(0x1 << lane);
+  }
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Read one byte from every lane.
+ *
+ * @param par      The parallel I2C.
+ * @param dst      The destination. Byte for lane l is written to dst[l * stride].
+ * @param stride   The distance between lanes in destination buffer.
+ * @param ack_type The ESP_I2C_ACK or ESP_I2C_NACK to send on all lanes.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ESP_I2C_BIT_ATTR
+par_read_byte(esp_i2c_par *par, uint8_t *dst, uint8_t stride, bool ack_type)
+{
+  uint8_t mask;
+  uint8_t lane;
+  uint32_t in;
+  esp_i2c_err err;
+
+  for (lane = 0; lane < par->lanes; lane++) dst[lane * stride] = 0;
+
+  for (mask = 0x80; mask; mask >>= 1) {
+    err = par_bit(par, true, &in);
+    if (err != ESP_I2C_OK) return err;
+
+    for (lane = 0; lane < par->lanes; lane++) {
+      if (in & par->lane_mask[lane]) dst[lane * stride] |= mask;
+    }
+  }
+
+  return par_bit(par, ack_type, &in);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_par_init(esp_i2c_par *par, esp_i2c_bus *bus, uint8_t *sda_gpios, uint8_t lanes)
+{
+  uint8_t lane;
+
+  if (lanes == 0 || lanes > ESP_I2C_PAR_MAX_LANES) return ESP_I2C_ERR_BAD_ARG;
+
+  par->bus = bus;
+  par->lanes = lanes;
+  par->sda_mask = 0;
+
+  for (lane = 0; lane < lanes; lane++) {
+    esp_gpio_setup(sda_gpios[lane], GPIO_MODE_INPUT);
+    par->lane_mask[lane] = (uint32_t) 0x1 << sda_gpios[lane];
+    par->sda_mask |= par->lane_mask[lane];
+  }
+
+  // SCL must not be one of the lanes.
+  if (par->sda_mask & bus->scl_mask) return ESP_I2C_ERR_INIT_CONFLICT;
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_par_transfer(esp_i2c_par *par,
+                     uint8_t address,
+                     uint8_t *wr_buf,
+                     uint8_t wr_len,
+                     uint8_t *rd_buf,
+                     uint8_t rd_len,
+                     uint8_t *acks)
+{
+  uint8_t idx;
+  esp_i2c_err err;
+
+  if (par->bus->in_trans || par->bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  *acks = (uint8_t) ((0x1 << par->lanes) - 1);
+  esp_i2c_use_profile(par->bus, address);
+
+  if (wr_len > 0 || rd_len == 0) {
+    err = par_start(par);
+    if (err != ESP_I2C_OK) return err;
+
+    err = par_write_byte(par, ESP_I2C_ADDR_WRITE(address), acks);
+    if (err != ESP_I2C_OK) return err;
+
+    for (idx = 0; idx < wr_len && *acks; idx++) {
+      err = par_write_byte(par, wr_buf[idx], acks);
+      if (err != ESP_I2C_OK) return err;
+    }
+  }
+
+  if (rd_len > 0 && *acks) {
+    err = par_start(par);
+    if (err != ESP_I2C_OK) return err;
+
+    err = par_write_byte(par, ESP_I2C_ADDR_READ(address), acks);
+    if (err != ESP_I2C_OK) return err;
+
+    for (idx = 0; idx < rd_len; idx++) {
+      err = par_read_byte(par, &rd_buf[idx], rd_len, idx == rd_len - 1 ? ESP_I2C_NACK : ESP_I2C_ACK);
+      if (err != ESP_I2C_OK) return err;
+    }
+  }
+
+  err = par_stop(par);
+  if (err != ESP_I2C_OK) return err;
+
+  return *acks ? ESP_I2C_OK : ESP_I2C_ERR_NO_ACK;
+}
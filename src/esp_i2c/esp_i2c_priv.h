@@ -0,0 +1,99 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Internal definitions shared by I2C library sources.
+// Not part of the public API.
+
+#ifndef ESP_I2C_PRIV_H
+#define ESP_I2C_PRIV_H
+
+#include <esp_i2c.h>
+
+// Makes GPIO an output and because GPIO_OUT for this bit
+// is 0 it will pull bus low.
+#define SDA_LOW(bus) (GPIO_OUT_EN_S = (bus)->sda_mask)
+#define SCL_LOW(bus) (GPIO_OUT_EN_S = (bus)->scl_mask)
+
+// Make GPIO an input and since there are pull up resistors
+// on the bus they will pull bus line high unless
+// some device is actively driving it low.
+// This is handy for SCL because when it's high we want to read it state.
+#define SDA_RELEASE(bus) (GPIO_OUT_EN_C = (bus)->sda_mask)
+#define SCL_RELEASE(bus) (GPIO_OUT_EN_C = (bus)->scl_mask)
+
+// Read GPIO state. Can be called only after *_RELEASE since only then
+// GPIO is setup as input.
+#define SDA_READ(bus) ((GPIO_IN & (bus)->sda_mask) != 0)
+#define SCL_READ(bus) ((GPIO_IN & (bus)->scl_mask) != 0)
+
+// I2C bus states.
+#define ESP_I2C_HIGH true
+#define ESP_I2C_LO false
+
+/**
+ * Get CPU cycle counter.
+ *
+ * @return The CCOUNT register value.
+ */
+static inline uint32_t
+get_ccount()
+{
+#ifdef ESP_HOST_TEST
+  // Simulated CPU (see test/host.h).
+  return host_ccount();
+#else
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0, ccount" : "=a" (ccount));
+  return ccount;
+#endif
+}
+
+/**
+ * Delay doing nothing.
+ *
+ * @param cycles The number of CPU cycles to wait.
+ */
+static inline void
+delay(uint32_t cycles)
+{
+  uint32_t start = get_ccount();
+
+  while (get_ccount() - start < cycles);
+}
+
+// Returned by esp_i2c_chk_cs when slave stretched the clock too long.
+#define ESP_I2C_CS_TIMEOUT 0xFFFFFFFF
+
+/**
+ * Wait for slave to release the clock.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return The clock stretching time in CPU cycles or ESP_I2C_CS_TIMEOUT.
+ */
+uint32_t ESP_I2C_BIT_ATTR
+esp_i2c_chk_cs(esp_i2c_bus *bus);
+
+/**
+ * Select device profile for the address.
+ *
+ * @param bus     The I2C bus.
+ * @param address The 7 bit slave address.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_use_profile(esp_i2c_bus *bus, uint16_t address);
+
+#endif //ESP_I2C_PRIV_H
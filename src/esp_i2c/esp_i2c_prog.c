@@ -0,0 +1,202 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_i2c_prog.h>
+#include "esp_i2c_priv.h"
+
+
+/**
+ * Append step to compiled transaction.
+ *
+ * @param prog  The compiled transaction.
+ * @param set   The lines to drive low.
+ * @param clr   The lines to release.
+ * @param delay The CPU cycles to wait after the step.
+ * @param flags The ESP_I2C_STEP_* flags.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+add_step(esp_i2c_prog *prog, uint32_t set, uint32_t clr, uint32_t delay, uint8_t flags)
+{
+  esp_i2c_step *step;
+
+  if (prog->len == prog->size) return ESP_I2C_ERR_MEM;
+
+  step = &prog->steps[prog->len++];
+  step->set = set;
+  step->clr = clr;
+  step->delay = delay;
+  step->flags = flags;
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Compile START condition.
+ *
+ * Same edges as esp_i2c_bus_start outside of transaction.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+add_start(esp_i2c_bus *bus, esp_i2c_prog *prog)
+{
+  esp_i2c_err err;
+  uint32_t both = bus->scl_mask | bus->sda_mask;
+
+  err = add_step(prog, 0, both, bus->delay_short, ESP_I2C_STEP_CHK_IDLE | ESP_I2C_STEP_CHK_CS);
+  if (err == ESP_I2C_OK) err = add_step(prog, bus->sda_mask, 0, bus->delay_short, 0);
+  if (err == ESP_I2C_OK) err = add_step(prog, bus->scl_mask, 0, bus->delay_short, 0);
+  if (err == ESP_I2C_OK) err = add_step(prog, 0, bus->sda_mask, 0, 0);
+
+  return err;
+}
+
+/**
+ * Compile STOP condition.
+ *
+ * Same edges as esp_i2c_bus_stop.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+add_stop(esp_i2c_bus *bus, esp_i2c_prog *prog)
+{
+  esp_i2c_err err;
+
+  err = add_step(prog, bus->sda_mask, 0, bus->delay_short, 0);
+  if (err == ESP_I2C_OK) err = add_step(prog, 0, bus->scl_mask, bus->delay_short, ESP_I2C_STEP_CHK_CS);
+  if (err == ESP_I2C_OK) err = add_step(prog, 0, bus->sda_mask, bus->delay_short, 0);
+  if (err == ESP_I2C_OK) err = add_step(prog, bus->scl_mask, 0, bus->delay_short, 0);
+
+  return err;
+}
+
+/**
+ * Compile byte write followed by ACK check.
+ *
+ * Data bits have the same edges as write_bit and ACK bit as read_bit.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+add_byte(esp_i2c_bus *bus, esp_i2c_prog *prog, uint8_t byte)
+{
+  uint8_t mask;
+  esp_i2c_err err = ESP_I2C_OK;
+
+  for (mask = 0x80; mask && err == ESP_I2C_OK; mask >>= 1) {
+    if (byte & mask) {
+      // Sample SDA in the middle of high phase to detect lost arbitration.
+      err = add_step(prog, 0, bus->sda_mask, bus->delay_short, 0);
+      if (err == ESP_I2C_OK) err = add_step(prog, 0, bus->scl_mask, bus->delay_short, ESP_I2C_STEP_CHK_CS);
+      if (err == ESP_I2C_OK) err = add_step(prog, 0, 0, bus->delay_short, ESP_I2C_STEP_CHK_ARB);
+    } else {
+      err = add_step(prog, bus->sda_mask, 0, bus->delay_short, 0);
+      if (err == ESP_I2C_OK) err = add_step(prog, 0, bus->scl_mask, bus->delay_long, ESP_I2C_STEP_CHK_CS);
+    }
+    if (err == ESP_I2C_OK) err = add_step(prog, bus->scl_mask, 0, bus->delay_short, 0);
+  }
+
+  // Release SDA for the slave to acknowledge.
+  if (err == ESP_I2C_OK) err = add_step(prog, 0, bus->sda_mask, bus->delay_short, 0);
+  if (err == ESP_I2C_OK) err = add_step(prog, 0, bus->scl_mask, bus->delay_short, ESP_I2C_STEP_CHK_CS);
+  if (err == ESP_I2C_OK) err = add_step(prog, 0, 0, bus->delay_short, ESP_I2C_STEP_CHK_ACK);
+  if (err == ESP_I2C_OK) err = add_step(prog, bus->scl_mask, 0, bus->delay_short, 0);
+
+  return err;
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_prog_init(esp_i2c_prog *prog, esp_i2c_step *steps, uint16_t size)
+{
+  prog->steps = steps;
+  prog->size = size;
+  prog->len = 0;
+  prog->address = 0;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_prog_write(esp_i2c_bus *bus, esp_i2c_prog *prog, uint8_t address, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+  uint16_t idx;
+  esp_i2c_err err;
+
+  prog->len = 0;
+  prog->address = address;
+
+  // Compile with timing of the device profile.
+  esp_i2c_use_profile(bus, address);
+
+  err = add_start(bus, prog);
+  if (err == ESP_I2C_OK) err = add_byte(bus, prog, ESP_I2C_ADDR_WRITE(address));
+  if (err == ESP_I2C_OK) err = add_byte(bus, prog, reg);
+
+  for (idx = 0; idx < len && err == ESP_I2C_OK; idx++) {
+    err = add_byte(bus, prog, buf[idx]);
+  }
+
+  if (err == ESP_I2C_OK) err = add_stop(bus, prog);
+  if (err != ESP_I2C_OK) prog->len = 0;
+
+  return err;
+}
+
+esp_i2c_err ESP_I2C_BIT_ATTR
+esp_i2c_prog_run(esp_i2c_bus *bus, esp_i2c_prog *prog)
+{
+  uint16_t idx;
+  esp_i2c_step *step;
+
+  if (bus->in_trans || bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  // Clock stretch limit of the device profile.
+  esp_i2c_use_profile(bus, prog->address);
+  bus->in_trans = true;
+
+  for (idx = 0; idx < prog->len; idx++) {
+    step = &prog->steps[idx];
+
+    GPIO_OUT_EN_C = step->clr;
+    GPIO_OUT_EN_S = step->set;
+
+    if (step->flags) {
+      // SDA held low before START is a bus fault, not lost arbitration.
+      if ((step->flags & ESP_I2C_STEP_CHK_IDLE) && SDA_READ(bus) == ESP_I2C_LO) {
+        return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_BUS_STUCK);
+      }
+
+      if ((step->flags & ESP_I2C_STEP_CHK_ARB) && SDA_READ(bus) == ESP_I2C_LO) {
+        bus->stats.arb_lost++;
+        return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_ARB_LOST);
+      }
+
+      if ((step->flags & ESP_I2C_STEP_CHK_CS) && esp_i2c_chk_cs(bus) == ESP_I2C_CS_TIMEOUT) {
+        return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_LONG_STRETCH);
+      }
+
+      if ((step->flags & ESP_I2C_STEP_CHK_ACK) && SDA_READ(bus) != ESP_I2C_ACK) {
+        // Finish ACK bit clock cycle before STOP.
+        SCL_LOW(bus);
+        delay(bus->delay_short);
+        esp_i2c_bus_stop(bus);
+        return esp_i2c_bus_fail_fast(bus, ESP_I2C_ERR_NO_ACK);
+      }
+    }
+
+    delay(step->delay);
+  }
+
+  bus->in_trans = false;
+
+  return ESP_I2C_OK;
+}
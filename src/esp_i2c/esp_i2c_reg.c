@@ -0,0 +1,312 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_i2c_reg.h>
+
+
+/**
+ * Encode register address.
+ *
+ * @param map The register map.
+ * @param reg The register.
+ * @param buf The buffer for at least 2 bytes.
+ *
+ * @return The number of address bytes.
+ */
+static uint8_t ICACHE_FLASH_ATTR
+reg_addr(esp_i2c_regmap *map, uint16_t reg, uint8_t *buf)
+{
+  if (map->flags & ESP_I2C_REG_ADDR16) {
+    buf[0] = (uint8_t) (reg >> 8);
+    buf[1] = (uint8_t) reg;
+    return 2;
+  }
+
+  buf[0] = (uint8_t) reg;
+  return 1;
+}
+
+/**
+ * Check if register is in the shadow cache.
+ *
+ * @param map The register map.
+ * @param reg The register.
+ *
+ * @return true if cached, false otherwise.
+ */
+static bool ICACHE_FLASH_ATTR
+is_cached(esp_i2c_regmap *map, uint16_t reg)
+{
+  return map->cache != NULL && reg >= map->cache_base && reg - map->cache_base < map->cache_len;
+}
+
+/**
+ * Set message fields.
+ */
+static void ICACHE_FLASH_ATTR
+set_msg(esp_i2c_msg *msg, uint8_t address, uint16_t flags, uint16_t len, uint8_t *buf)
+{
+  msg->address = address;
+  msg->flags = flags;
+  msg->len = len;
+  msg->buf = buf;
+}
+
+/**
+ * Read registers from the device.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+bus_read(esp_i2c_regmap *map, uint16_t reg, uint8_t *buf, uint16_t len)
+{
+  uint8_t abuf[2];
+  esp_i2c_msg msgs[2];
+
+  set_msg(&msgs[0], map->address, 0, reg_addr(map, reg, abuf), abuf);
+  set_msg(&msgs[1], map->address, ESP_I2C_M_RD, len, buf);
+
+  return esp_i2c_bus_transfer(map->bus, msgs, 2);
+}
+
+/**
+ * Write registers to the device.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+bus_write(esp_i2c_regmap *map, uint16_t reg, uint8_t *buf, uint16_t len)
+{
+  uint8_t abuf[2];
+  esp_i2c_msg msgs[2];
+
+  set_msg(&msgs[0], map->address, 0, reg_addr(map, reg, abuf), abuf);
+  set_msg(&msgs[1], map->address, ESP_I2C_M_NOSTART, len, buf);
+
+  return esp_i2c_bus_transfer(map->bus, msgs, 2);
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_reg_init(esp_i2c_regmap *map, esp_i2c_bus *bus, uint8_t address, uint8_t flags)
+{
+  os_memset(map, 0, sizeof(esp_i2c_regmap));
+
+  map->bus = bus;
+  map->address = address;
+  map->flags = flags;
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_reg_cache(esp_i2c_regmap *map, uint16_t base, uint16_t len, uint8_t *values, uint8_t *state)
+{
+  map->cache_base = base;
+  map->cache_len = len;
+  map->cache = values;
+  map->state = state;
+
+  esp_i2c_reg_invalidate(map);
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_reg_invalidate(esp_i2c_regmap *map)
+{
+  if (map->state != NULL) os_memset(map->state, 0, map->cache_len);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_read(esp_i2c_regmap *map, uint16_t reg, uint8_t *buf, uint16_t len)
+{
+  uint16_t idx;
+  uint16_t pos;
+  esp_i2c_err err;
+
+  for (idx = 0; idx < len; idx++) {
+    if (!is_cached(map, reg + idx)) break;
+    if (!(map->state[reg + idx - map->cache_base] & ESP_I2C_REG_VALID)) break;
+  }
+
+  // All values are in the cache.
+  if (idx == len) {
+    os_memcpy(buf, &map->cache[reg - map->cache_base], len);
+    return ESP_I2C_OK;
+  }
+
+  err = bus_read(map, reg, buf, len);
+  if (err != ESP_I2C_OK) return err;
+
+  for (idx = 0; idx < len; idx++) {
+    if (!is_cached(map, reg + idx)) continue;
+    pos = reg + idx - map->cache_base;
+
+    // Not flushed value is what the register is going to be.
+    if (map->state[pos] & ESP_I2C_REG_DIRTY) {
+      buf[idx] = map->cache[pos];
+    } else {
+      map->cache[pos] = buf[idx];
+      map->state[pos] = ESP_I2C_REG_VALID;
+    }
+  }
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_write(esp_i2c_regmap *map, uint16_t reg, uint8_t *buf, uint16_t len)
+{
+  uint16_t idx;
+  uint16_t pos;
+  esp_i2c_err err;
+
+  err = bus_write(map, reg, buf, len);
+  if (err != ESP_I2C_OK) return err;
+
+  for (idx = 0; idx < len; idx++) {
+    if (!is_cached(map, reg + idx)) continue;
+    pos = reg + idx - map->cache_base;
+    map->cache[pos] = buf[idx];
+    map->state[pos] = ESP_I2C_REG_VALID;
+  }
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_read_val(esp_i2c_regmap *map, uint16_t reg, uint8_t width, uint32_t *val)
+{
+  uint8_t idx;
+  uint8_t buf[4];
+  esp_i2c_err err;
+
+  if (width == 0 || width > 4) return ESP_I2C_ERR_BAD_ARG;
+
+  err = esp_i2c_reg_read(map, reg, buf, width);
+  if (err != ESP_I2C_OK) return err;
+
+  *val = 0;
+  for (idx = 0; idx < width; idx++) {
+    if (map->flags & ESP_I2C_REG_BE) {
+      *val = (*val << 8) | buf[idx];
+    } else {
+      *val |= (uint32_t) buf[idx] << (8 * idx);
+    }
+  }
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_write_val(esp_i2c_regmap *map, uint16_t reg, uint8_t width, uint32_t val)
+{
+  uint8_t idx;
+  uint8_t buf[4];
+
+  if (width == 0 || width > 4) return ESP_I2C_ERR_BAD_ARG;
+
+  for (idx = 0; idx < width; idx++) {
+    if (map->flags & ESP_I2C_REG_BE) {
+      buf[width - 1 - idx] = (uint8_t) (val >> (8 * idx));
+    } else {
+      buf[idx] = (uint8_t) (val >> (8 * idx));
+    }
+  }
+
+  return esp_i2c_reg_write(map, reg, buf, width);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_update(esp_i2c_regmap *map, uint16_t reg, uint8_t mask, uint8_t value)
+{
+  uint16_t pos;
+  uint8_t curr;
+  esp_i2c_err err;
+
+  if (!is_cached(map, reg)) {
+    err = bus_read(map, reg, &curr, 1);
+    if (err != ESP_I2C_OK) return err;
+
+    value = (curr & ~mask) | (value & mask);
+    if (value == curr) return ESP_I2C_OK;
+
+    return bus_write(map, reg, &value, 1);
+  }
+
+  pos = reg - map->cache_base;
+
+  if (!(map->state[pos] & ESP_I2C_REG_VALID)) {
+    err = bus_read(map, reg, &map->cache[pos], 1);
+    if (err != ESP_I2C_OK) return err;
+    map->state[pos] = ESP_I2C_REG_VALID;
+  }
+
+  value = (map->cache[pos] & ~mask) | (value & mask);
+  if (value == map->cache[pos]) return ESP_I2C_OK;
+
+  map->cache[pos] = value;
+  map->state[pos] |= ESP_I2C_REG_DIRTY;
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_flush(esp_i2c_regmap *map)
+{
+  uint16_t idx = 0;
+  uint16_t pos;
+  uint16_t start;
+  uint16_t end;
+  uint8_t runs;
+  esp_i2c_err err;
+  uint8_t *state = map->state;
+  uint8_t abuf[ESP_I2C_REG_FLUSH_RUNS][2];
+  esp_i2c_msg msgs[2 * ESP_I2C_REG_FLUSH_RUNS];
+
+  if (map->cache == NULL) return ESP_I2C_OK;
+
+  do {
+    runs = 0;
+
+    while (runs < ESP_I2C_REG_FLUSH_RUNS) {
+      // Find next dirty register.
+      while (idx < map->cache_len && !(state[idx] & ESP_I2C_REG_DIRTY)) idx++;
+      if (idx == map->cache_len) break;
+
+      // Extend the run over dirty registers. Short gaps of clean
+      // registers are cheaper to write again than to start new run.
+      start = idx;
+      end = idx + 1;
+      for (pos = end; pos < map->cache_len && pos - end <= ESP_I2C_REG_FLUSH_GAP; pos++) {
+        if (!(state[pos] & ESP_I2C_REG_VALID)) break;
+        if (state[pos] & ESP_I2C_REG_DIRTY) end = pos + 1;
+      }
+
+      set_msg(&msgs[2 * runs],
+              map->address,
+              0,
+              reg_addr(map, map->cache_base + start, abuf[runs]),
+              abuf[runs]);
+      set_msg(&msgs[2 * runs + 1], map->address, ESP_I2C_M_NOSTART, end - start, &map->cache[start]);
+
+      runs++;
+      idx = end;
+    }
+
+    if (runs == 0) break;
+
+    err = esp_i2c_bus_transfer(map->bus, msgs, (uint8_t) (2 * runs));
+    if (err != ESP_I2C_OK) return err;
+
+    for (pos = 0; pos < idx; pos++) state[pos] &= ~ESP_I2C_REG_DIRTY;
+  } while (idx < map->cache_len);
+
+  return ESP_I2C_OK;
+}
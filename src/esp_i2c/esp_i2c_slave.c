@@ -0,0 +1,356 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "esp_i2c_priv.h"
+#include <esp_i2c_slave.h>
+#include <ets_sys.h>
+#include <gpio.h>
+
+// Functions called from the GPIO interrupt handler are not marked
+// with ICACHE_FLASH_ATTR so they are placed in IRAM.
+
+
+/**
+ * Load register pointed by register pointer and send its MSB.
+ *
+ * @param slave The I2C slave.
+ */
+static inline void
+slave_tx_load(esp_i2c_slave *slave)
+{
+  slave->byte = slave->regs[slave->reg];
+  slave->bits = 0;
+  slave->state = ESP_I2C_SLAVE_TX;
+}
+
+/**
+ * Put next bit on SDA. Must be called with SCL low.
+ *
+ * @param slave The I2C slave.
+ */
+static inline void
+slave_tx_bit(esp_i2c_slave *slave)
+{
+  if (slave->byte & 0x80) {
+    SDA_RELEASE(slave);
+  } else {
+    SDA_LOW(slave);
+  }
+  slave->byte <<= 1;
+  slave->bits++;
+}
+
+/**
+ * Advance register pointer wrapping around at the window size.
+ *
+ * @param slave The I2C slave.
+ */
+static inline void
+slave_reg_next(esp_i2c_slave *slave)
+{
+  slave->reg = (uint8_t) ((slave->reg + 1) % slave->regs_len);
+}
+
+/**
+ * Report bytes written by master.
+ *
+ * @param slave The I2C slave.
+ */
+static void
+slave_written(esp_i2c_slave *slave)
+{
+  if (slave->written > 0 && slave->cb != NULL) {
+    slave->cb(slave, ESP_I2C_SLAVE_EV_WRITE, slave->reg_start, slave->written);
+  }
+  slave->written = 0;
+}
+
+/**
+ * Handle START or repeated START.
+ *
+ * @param slave The I2C slave.
+ */
+static void
+slave_start(esp_i2c_slave *slave)
+{
+  slave_written(slave);
+  SDA_RELEASE(slave);
+
+  slave->state = ESP_I2C_SLAVE_ADDR;
+  slave->byte = 0;
+  slave->bits = 0;
+  slave->reading = false;
+  slave->reg_set = false;
+}
+
+/**
+ * Handle STOP.
+ *
+ * @param slave The I2C slave.
+ */
+static void
+slave_stop(esp_i2c_slave *slave)
+{
+  slave_written(slave);
+  SDA_RELEASE(slave);
+  SCL_RELEASE(slave);
+
+  slave->state = ESP_I2C_SLAVE_IDLE;
+}
+
+/**
+ * Handle SCL rising edge. Samples SDA.
+ *
+ * @param slave The I2C slave.
+ * @param sda   The SDA state.
+ */
+static void
+slave_scl_rise(esp_i2c_slave *slave, bool sda)
+{
+  switch (slave->state) {
+    case ESP_I2C_SLAVE_ADDR:
+    case ESP_I2C_SLAVE_RX:
+      slave->byte = (uint8_t) ((slave->byte << 1) | sda);
+      slave->bits++;
+      break;
+
+    case ESP_I2C_SLAVE_ACK_IN:
+      slave->state = sda ? ESP_I2C_SLAVE_IGNORE : ESP_I2C_SLAVE_TX_NEXT;
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * Check if slave drives SDA in the bit starting at SCL falling edge.
+ *
+ * @param slave The I2C slave.
+ *
+ * @return true if slave sets up SDA, false otherwise.
+ */
+static inline bool
+slave_drives_sda(esp_i2c_slave *slave)
+{
+  switch (slave->state) {
+    case ESP_I2C_SLAVE_ADDR:
+      return slave->bits == 8 && (slave->byte >> 1) == slave->address;
+
+    case ESP_I2C_SLAVE_RX:
+      return slave->bits == 8;
+
+    case ESP_I2C_SLAVE_ACK_OUT:
+    case ESP_I2C_SLAVE_TX:
+    case ESP_I2C_SLAVE_TX_NEXT:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/**
+ * Handle SCL falling edge. Drives SDA.
+ *
+ * The SCL is held low while SDA is being set up so the
+ * interrupt latency never violates data setup time. The clock
+ * is not touched in bits this slave does not drive.
+ *
+ * @param slave The I2C slave.
+ */
+static void
+slave_scl_fall(esp_i2c_slave *slave)
+{
+  if (!slave_drives_sda(slave)) {
+    // Other device was addressed.
+    if (slave->state == ESP_I2C_SLAVE_ADDR && slave->bits == 8) slave->state = ESP_I2C_SLAVE_IGNORE;
+    return;
+  }
+
+  SCL_LOW(slave);
+
+  switch (slave->state) {
+    case ESP_I2C_SLAVE_ADDR:
+      slave->reading = (bool) (slave->byte & 0x01);
+      SDA_LOW(slave);
+      slave->state = ESP_I2C_SLAVE_ACK_OUT;
+      break;
+
+    case ESP_I2C_SLAVE_RX:
+      if (!slave->reg_set) {
+        slave->reg = (uint8_t) (slave->byte % slave->regs_len);
+        slave->reg_start = slave->reg;
+        slave->reg_set = true;
+      } else {
+        slave->regs[slave->reg] = slave->byte;
+        slave_reg_next(slave);
+        slave->written++;
+      }
+      SDA_LOW(slave);
+      slave->state = ESP_I2C_SLAVE_ACK_OUT;
+      break;
+
+    case ESP_I2C_SLAVE_ACK_OUT:
+      SDA_RELEASE(slave);
+      if (!slave->reading) {
+        slave->state = ESP_I2C_SLAVE_RX;
+        slave->byte = 0;
+        slave->bits = 0;
+        break;
+      }
+
+      // Master reads: give application a chance to fill the
+      // register window while the clock is stretched.
+      slave->reg_start = slave->reg;
+      slave->stretch_start = get_ccount();
+      if (slave->cb != NULL && !slave->cb(slave, ESP_I2C_SLAVE_EV_READ, slave->reg, 0)) {
+        slave->state = ESP_I2C_SLAVE_STRETCH;
+        return; // Keep SCL low till esp_i2c_slave_ready.
+      }
+      slave_tx_load(slave);
+      slave_tx_bit(slave);
+      slave->first_byte_cycles = get_ccount() - slave->stretch_start;
+      break;
+
+    case ESP_I2C_SLAVE_TX:
+      if (slave->bits < 8) {
+        slave_tx_bit(slave);
+      } else {
+        SDA_RELEASE(slave);
+        slave->state = ESP_I2C_SLAVE_ACK_IN;
+      }
+      break;
+
+    case ESP_I2C_SLAVE_TX_NEXT:
+      slave_reg_next(slave);
+      slave_tx_load(slave);
+      slave_tx_bit(slave);
+      break;
+
+    default:
+      break;
+  }
+
+  SCL_RELEASE(slave);
+}
+
+/**
+ * GPIO interrupt handler.
+ *
+ * @param arg The I2C slave.
+ */
+static void
+slave_isr(void *arg)
+{
+  esp_i2c_slave *slave = arg;
+  uint32_t status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);
+  uint32_t in = GPIO_IN;
+  uint32_t changed = in ^ slave->last_in;
+
+  GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, status & (slave->scl_mask | slave->sda_mask));
+  slave->last_in = in;
+
+  // SDA edge while SCL is high is START or STOP condition.
+  if ((changed & slave->sda_mask) && !(changed & slave->scl_mask) && (in & slave->scl_mask)) {
+    if (in & slave->sda_mask) {
+      slave_stop(slave);
+    } else {
+      slave_start(slave);
+    }
+    return;
+  }
+
+  if (!(changed & slave->scl_mask)) return;
+  if (slave->state == ESP_I2C_SLAVE_IDLE || slave->state == ESP_I2C_SLAVE_IGNORE) return;
+
+  if (in & slave->scl_mask) {
+    slave_scl_rise(slave, (in & slave->sda_mask) != 0);
+  } else {
+    slave_scl_fall(slave);
+  }
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_slave_init(esp_i2c_slave *slave,
+                   uint8_t scl_gpio,
+                   uint8_t sda_gpio,
+                   uint8_t address,
+                   uint8_t *regs,
+                   uint16_t regs_len,
+                   esp_i2c_slave_cb cb)
+{
+  if (scl_gpio == sda_gpio) return ESP_I2C_ERR_INIT_CONFLICT;
+  if (regs == NULL || regs_len == 0 || regs_len > 256) return ESP_I2C_ERR_BAD_ARG;
+  if (ESP_I2C_ADDR_RESERVED(address)) return ESP_I2C_ERR_BAD_ARG;
+
+  os_memset(slave, 0, sizeof(esp_i2c_slave));
+
+  esp_gpio_setup(scl_gpio, GPIO_MODE_INPUT);
+  esp_gpio_setup(sda_gpio, GPIO_MODE_INPUT);
+
+  slave->gpio_scl = scl_gpio;
+  slave->gpio_sda = sda_gpio;
+  slave->scl_mask = (uint32_t) 0x1 << scl_gpio;
+  slave->sda_mask = (uint32_t) 0x1 << sda_gpio;
+  slave->address = address;
+  slave->regs = regs;
+  slave->regs_len = regs_len;
+  slave->cb = cb;
+  slave->state = ESP_I2C_SLAVE_IDLE;
+  slave->last_in = GPIO_IN;
+
+  ETS_GPIO_INTR_DISABLE();
+  ETS_GPIO_INTR_ATTACH(slave_isr, slave);
+  gpio_pin_intr_state_set(GPIO_ID_PIN(scl_gpio), GPIO_PIN_INTR_ANYEDGE);
+  gpio_pin_intr_state_set(GPIO_ID_PIN(sda_gpio), GPIO_PIN_INTR_ANYEDGE);
+  GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, slave->scl_mask | slave->sda_mask);
+  ETS_GPIO_INTR_ENABLE();
+
+  return ESP_I2C_OK;
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_slave_ready(esp_i2c_slave *slave)
+{
+  ETS_GPIO_INTR_DISABLE();
+
+  if (slave->state == ESP_I2C_SLAVE_STRETCH) {
+    slave_tx_load(slave);
+    slave_tx_bit(slave);
+    slave->first_byte_cycles = get_ccount() - slave->stretch_start;
+    SCL_RELEASE(slave);
+  }
+
+  ETS_GPIO_INTR_ENABLE();
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_slave_stop(esp_i2c_slave *slave)
+{
+  ETS_GPIO_INTR_DISABLE();
+
+  gpio_pin_intr_state_set(GPIO_ID_PIN(slave->gpio_scl), GPIO_PIN_INTR_DISABLE);
+  gpio_pin_intr_state_set(GPIO_ID_PIN(slave->gpio_sda), GPIO_PIN_INTR_DISABLE);
+  GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, slave->scl_mask | slave->sda_mask);
+
+  SDA_RELEASE(slave);
+  SCL_RELEASE(slave);
+  slave->state = ESP_I2C_SLAVE_IDLE;
+
+  ETS_GPIO_INTR_ENABLE();
+}
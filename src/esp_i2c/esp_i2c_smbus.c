@@ -0,0 +1,375 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_i2c_smbus.h>
+#include "esp_i2c_priv.h"
+
+// The PEC lookup table (CRC-8, polynomial 0x07).
+static uint8_t pec_lookup[] = {
+  0, 7, 14, 9, 28, 27, 18, 21, 56, 63, 54, 49, 36, 35, 42, 45,
+  112, 119, 126, 121, 108, 107, 98, 101, 72, 79, 70, 65, 84, 83, 90, 93,
+  224, 231, 238, 233, 252, 251, 242, 245, 216, 223, 214, 209, 196, 195, 202, 205,
+  144, 151, 158, 153, 140, 139, 130, 133, 168, 175, 166, 161, 180, 179, 186, 189,
+  199, 192, 201, 206, 219, 220, 213, 210, 255, 248, 241, 246, 227, 228, 237, 234,
+  183, 176, 185, 190, 171, 172, 165, 162, 143, 136, 129, 134, 147, 148, 157, 154,
+  39, 32, 41, 46, 59, 60, 53, 50, 31, 24, 17, 22, 3, 4, 13, 10,
+  87, 80, 89, 94, 75, 76, 69, 66, 111, 104, 97, 102, 115, 116, 125, 122,
+  137, 142, 135, 128, 149, 146, 155, 156, 177, 182, 191, 184, 173, 170, 163, 164,
+  249, 254, 247, 240, 229, 226, 235, 236, 193, 198, 207, 200, 221, 218, 211, 212,
+  105, 110, 103, 96, 117, 114, 123, 124, 81, 86, 95, 88, 77, 74, 67, 68,
+  25, 30, 23, 16, 5, 2, 11, 12, 33, 38, 47, 40, 61, 58, 51, 52,
+  78, 73, 64, 71, 82, 85, 92, 91, 118, 113, 120, 127, 106, 109, 100, 99,
+  62, 57, 48, 55, 34, 37, 44, 43, 6, 1, 8, 15, 26, 29, 20, 19,
+  174, 169, 160, 167, 178, 181, 188, 187, 150, 145, 152, 159, 138, 141, 132, 131,
+  222, 217, 208, 215, 194, 197, 204, 203, 230, 225, 232, 239, 250, 253, 244, 243};
+
+uint8_t ICACHE_FLASH_ATTR
+esp_i2c_smbus_pec(uint8_t pec, uint8_t value)
+{
+  return pec_lookup[pec ^ value];
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_smbus_init(esp_i2c_smbus *sm, esp_i2c_bus *bus, uint8_t address, bool pec)
+{
+  sm->bus = bus;
+  sm->address = address;
+  sm->pec = pec;
+  sm->crc = 0;
+}
+
+/**
+ * Write byte updating the PEC.
+ *
+ * @param sm   The SMBus device.
+ * @param data The byte to write.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+sm_write(esp_i2c_smbus *sm, uint8_t data)
+{
+  bool ack_resp;
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_write_byte(sm->bus, data, &ack_resp);
+  if (err != ESP_I2C_OK) return err;
+
+  if (ack_resp != ESP_I2C_ACK) {
+    esp_i2c_bus_stop(sm->bus);
+    return esp_i2c_bus_fail_fast(sm->bus, ESP_I2C_ERR_NO_ACK);
+  }
+
+  sm->crc = pec_lookup[sm->crc ^ data];
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * START or repeated START followed by the address.
+ *
+ * @param sm   The SMBus device.
+ * @param read The read / write bit value.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+sm_start(esp_i2c_smbus *sm, bool read)
+{
+  esp_i2c_err err;
+
+  // New transaction starts new PEC.
+  if (!sm->bus->in_trans) sm->crc = 0;
+
+  esp_i2c_use_profile(sm->bus, sm->address);
+  err = esp_i2c_bus_start(sm->bus);
+  if (err != ESP_I2C_OK) return err;
+
+  if (read) return sm_write(sm, ESP_I2C_ADDR_READ(sm->address));
+
+  return sm_write(sm, ESP_I2C_ADDR_WRITE(sm->address));
+}
+
+/**
+ * Read byte updating the PEC.
+ *
+ * @param sm   The SMBus device.
+ * @param data The read byte.
+ * @param last Set for the last data byte of the transaction.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+sm_read(esp_i2c_smbus *sm, uint8_t *data, bool last)
+{
+  esp_i2c_err err;
+
+  // When PEC is enabled it follows the last data byte.
+  err = esp_i2c_bus_read_byte(sm->bus, data, (last && !sm->pec) ? ESP_I2C_NACK : ESP_I2C_ACK);
+  if (err != ESP_I2C_OK) return err;
+
+  sm->crc = pec_lookup[sm->crc ^ *data];
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Finish write transaction sending PEC if enabled.
+ *
+ * @param sm The SMBus device.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+sm_write_end(esp_i2c_smbus *sm)
+{
+  esp_i2c_err err;
+
+  if (sm->pec) {
+    err = sm_write(sm, sm->crc);
+    if (err != ESP_I2C_OK) return err;
+  }
+
+  return esp_i2c_bus_stop(sm->bus);
+}
+
+/**
+ * Finish read transaction checking PEC if enabled.
+ *
+ * @param sm The SMBus device.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+sm_read_end(esp_i2c_smbus *sm)
+{
+  uint8_t pec = 0;
+  esp_i2c_err err;
+
+  if (sm->pec) {
+    err = esp_i2c_bus_read_byte(sm->bus, &pec, ESP_I2C_NACK);
+    if (err != ESP_I2C_OK) return err;
+  }
+
+  err = esp_i2c_bus_stop(sm->bus);
+  if (err != ESP_I2C_OK) return err;
+
+  if (sm->pec && pec != sm->crc) return ESP_I2C_ERR_DATA_CORRUPTED;
+
+  return ESP_I2C_OK;
+}
+
+/**
+ * Start write transaction and send command code.
+ *
+ * @param sm  The SMBus device.
+ * @param cmd The command code.
+ *
+ * @return The I2C error code.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+sm_command(esp_i2c_smbus *sm, uint8_t cmd)
+{
+  esp_i2c_err err;
+
+  err = sm_start(sm, false);
+  if (err != ESP_I2C_OK) return err;
+
+  return sm_write(sm, cmd);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_quick(esp_i2c_smbus *sm, bool read)
+{
+  esp_i2c_err err;
+
+  err = sm_start(sm, read);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(sm->bus);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_send_byte(esp_i2c_smbus *sm, uint8_t data)
+{
+  esp_i2c_err err;
+
+  err = sm_command(sm, data);
+  if (err != ESP_I2C_OK) return err;
+
+  return sm_write_end(sm);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_receive_byte(esp_i2c_smbus *sm, uint8_t *data)
+{
+  esp_i2c_err err;
+
+  err = sm_start(sm, true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_read(sm, data, true);
+  if (err != ESP_I2C_OK) return err;
+
+  return sm_read_end(sm);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_write_byte(esp_i2c_smbus *sm, uint8_t cmd, uint8_t data)
+{
+  esp_i2c_err err;
+
+  err = sm_command(sm, cmd);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_write(sm, data);
+  if (err != ESP_I2C_OK) return err;
+
+  return sm_write_end(sm);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_read_byte(esp_i2c_smbus *sm, uint8_t cmd, uint8_t *data)
+{
+  esp_i2c_err err;
+
+  err = sm_command(sm, cmd);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_start(sm, true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_read(sm, data, true);
+  if (err != ESP_I2C_OK) return err;
+
+  return sm_read_end(sm);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_write_word(esp_i2c_smbus *sm, uint8_t cmd, uint16_t data)
+{
+  esp_i2c_err err;
+
+  err = sm_command(sm, cmd);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_write(sm, (uint8_t) data);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_write(sm, (uint8_t) (data >> 8));
+  if (err != ESP_I2C_OK) return err;
+
+  return sm_write_end(sm);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_read_word(esp_i2c_smbus *sm, uint8_t cmd, uint16_t *data)
+{
+  uint8_t lo;
+  uint8_t hi;
+  esp_i2c_err err;
+
+  err = sm_command(sm, cmd);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_start(sm, true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_read(sm, &lo, false);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_read(sm, &hi, true);
+  if (err != ESP_I2C_OK) return err;
+
+  *data = (uint16_t) (lo | (hi << 8));
+
+  return sm_read_end(sm);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_block_write(esp_i2c_smbus *sm, uint8_t cmd, uint8_t *buf, uint8_t len)
+{
+  uint8_t idx;
+  esp_i2c_err err;
+
+  err = sm_command(sm, cmd);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_write(sm, len);
+  if (err != ESP_I2C_OK) return err;
+
+  for (idx = 0; idx < len; idx++) {
+    err = sm_write(sm, buf[idx]);
+    if (err != ESP_I2C_OK) return err;
+  }
+
+  return sm_write_end(sm);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_block_read(esp_i2c_smbus *sm, uint8_t cmd, uint8_t *buf, uint8_t max, uint8_t *len)
+{
+  uint8_t idx;
+  uint8_t count;
+  uint8_t data;
+  esp_i2c_err err;
+
+  err = sm_command(sm, cmd);
+  if (err != ESP_I2C_OK) return err;
+
+  err = sm_start(sm, true);
+  if (err != ESP_I2C_OK) return err;
+
+  // Count byte is followed by data (or PEC) unless the count is zero.
+  err = sm_read(sm, &count, false);
+  if (err != ESP_I2C_OK) return err;
+
+  if (count > max || (count == 0 && !sm->pec)) {
+    // Count was acknowledged so terminate the read cleanly with NACK.
+    esp_i2c_bus_read_byte(sm->bus, &data, ESP_I2C_NACK);
+    err = esp_i2c_bus_stop(sm->bus);
+    if (err != ESP_I2C_OK) return err;
+    *len = 0;
+    return count > max ? ESP_I2C_ERR_DATA_CORRUPTED : ESP_I2C_OK;
+  }
+
+  for (idx = 0; idx < count; idx++) {
+    err = sm_read(sm, &buf[idx], idx == count - 1);
+    if (err != ESP_I2C_OK) return err;
+  }
+
+  *len = count;
+
+  return sm_read_end(sm);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_alert(esp_i2c_bus *bus, uint8_t *address)
+{
+  uint8_t data = 0;
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR_READ(ESP_I2C_SMBUS_ARA), true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_read_byte(bus, &data, ESP_I2C_NACK);
+  if (err != ESP_I2C_OK) return err;
+
+  *address = data >> 1;
+
+  return esp_i2c_bus_stop(bus);
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "esp_i2c_priv.h"
+#include <esp_i2c_trig.h>
+
+
+/**
+ * Send one trigger write without STOP.
+ *
+ * @param bus     The I2C bus.
+ * @param address The 7 bit slave address.
+ * @param buf     The bytes to send.
+ * @param len     The number of bytes.
+ * @param ccount  Set to CCOUNT after the last byte was acknowledged.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_NO_ACK leaves transaction open.
+ */
+static esp_i2c_err ICACHE_FLASH_ATTR
+trig_write(esp_i2c_bus *bus, uint8_t address, uint8_t *buf, uint8_t len, uint32_t *ccount)
+{
+  uint8_t idx;
+  bool ack_resp;
+  esp_i2c_err err;
+
+  esp_i2c_use_profile(bus, address);
+  err = esp_i2c_bus_start(bus);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_write_byte(bus, ESP_I2C_ADDR_WRITE(address), &ack_resp);
+  if (err != ESP_I2C_OK) return err;
+  if (ack_resp != ESP_I2C_ACK) return ESP_I2C_ERR_NO_ACK;
+
+  for (idx = 0; idx < len; idx++) {
+    err = esp_i2c_bus_write_byte(bus, buf[idx], &ack_resp);
+    if (err != ESP_I2C_OK) return err;
+    if (ack_resp != ESP_I2C_ACK) return ESP_I2C_ERR_NO_ACK;
+  }
+
+  *ccount = get_ccount();
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_general_call(esp_i2c_bus *bus, uint8_t *buf, uint16_t len)
+{
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_start_read_write(bus, ESP_I2C_ADDR_WRITE(ESP_I2C_GC_ADDR), true);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_write_bytes(bus, buf, len);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(bus);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_gc_reset(esp_i2c_bus *bus)
+{
+  uint8_t cmd = ESP_I2C_GC_RESET;
+
+  return esp_i2c_bus_general_call(bus, &cmd, 1);
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_gc_latch(esp_i2c_bus *bus)
+{
+  uint8_t cmd = ESP_I2C_GC_LATCH;
+
+  return esp_i2c_bus_general_call(bus, &cmd, 1);
+}
+
+void ICACHE_FLASH_ATTR
+esp_i2c_trig_init_gc(esp_i2c_trig_group *group, esp_i2c_bus *bus, uint8_t *buf, uint8_t len)
+{
+  os_memset(group, 0, sizeof(esp_i2c_trig_group));
+
+  group->bus = bus;
+  group->gc_buf = buf;
+  group->gc_len = len;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_trig_init(esp_i2c_trig_group *group, esp_i2c_bus *bus, esp_i2c_trig *trigs, uint8_t num)
+{
+  if (num == 0 || num > ESP_I2C_TRIG_MAX) return ESP_I2C_ERR_BAD_ARG;
+
+  os_memset(group, 0, sizeof(esp_i2c_trig_group));
+
+  group->bus = bus;
+  group->trigs = trigs;
+  group->num = num;
+
+  return ESP_I2C_OK;
+}
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_trig_fire(esp_i2c_trig_group *group)
+{
+  uint8_t idx;
+  uint32_t ccount;
+  bool triggered = false;
+  esp_i2c_trig *trig;
+  esp_i2c_bus *bus = group->bus;
+  esp_i2c_err err;
+
+  if (bus->in_trans || bus->async_head != NULL) return ESP_I2C_ERR_BUSY;
+
+  group->nacks = 0;
+  group->skew = 0;
+
+  if (group->num == 0) {
+    // One general call reaches all devices at the same moment.
+    err = trig_write(bus, ESP_I2C_GC_ADDR, group->gc_buf, group->gc_len, &group->ccount);
+    if (err == ESP_I2C_ERR_NO_ACK) group->nacks = 1;
+    if (err != ESP_I2C_OK && err != ESP_I2C_ERR_NO_ACK) return err;
+
+    triggered = (err == ESP_I2C_OK);
+  } else {
+    for (idx = 0; idx < group->num; idx++) {
+      trig = &group->trigs[idx];
+
+      // Next trigger follows with repeated START.
+      err = trig_write(bus, trig->address, trig->buf, trig->len, &ccount);
+      if (err == ESP_I2C_ERR_NO_ACK) {
+        group->nacks |= (uint32_t) 0x1 << idx;
+        continue;
+      }
+      if (err != ESP_I2C_OK) return err;
+
+      if (!triggered) group->ccount = ccount;
+      group->skew = ccount - group->ccount;
+      triggered = true;
+    }
+  }
+
+  err = esp_i2c_bus_stop(bus);
+  if (err != ESP_I2C_OK) return err;
+
+  return triggered ? ESP_I2C_OK : ESP_I2C_ERR_NO_ACK;
+}
@@ -19,22 +19,104 @@
 #define ESP_I2C_H
 
 #include <c_types.h>
+#include <osapi.h>
 #include <esp_gpio.h>
 
+// Section attribute for per bit routines. When library is built
+// with ESP_I2C_IRAM they are placed in IRAM so flash cache misses
+// can not stretch bit timing. Setup code always stays in flash.
+#ifdef ESP_I2C_IRAM
+  #define ESP_I2C_BIT_ATTR
+#else
+  #define ESP_I2C_BIT_ATTR ICACHE_FLASH_ATTR
+#endif
+
 
 #define ESP_I2C_ACK false
 #define ESP_I2C_NACK true
 
-#define ESP_I2C_SPEED_100 9
-#define ESP_I2C_SPEED_200 5
-#define ESP_I2C_SPEED_300 3
-#define ESP_I2C_SPEED_400 1
+// Common I2C bus speeds in Hz.
+#define ESP_I2C_SPEED_100 100000
+#define ESP_I2C_SPEED_200 200000
+#define ESP_I2C_SPEED_300 300000
+#define ESP_I2C_SPEED_400 400000
+#define ESP_I2C_SPEED_1000 1000000
 
 // Get address with read bit set.
 #define ESP_I2C_ADDR_READ(addr) ((uint8_t) (((addr) << 1) | 0x01))
 // Get address with write bit set.
 #define ESP_I2C_ADDR_WRITE(addr) ((uint8_t) (((addr) << 1) & 0xFE))
 
+// Get first byte of 10 bit address (11110 A9 A8 R/W).
+#define ESP_I2C_ADDR10_HI(addr, read) ((uint8_t) (0xF0 | (((addr) >> 7) & 0x06) | ((read) ? 0x01 : 0x00)))
+// Get second byte of 10 bit address (A7 - A0).
+#define ESP_I2C_ADDR10_LO(addr) ((uint8_t) ((addr) & 0xFF))
+// No 10 bit address selected.
+#define ESP_I2C_ADDR10_NONE 0xFFFF
+// Get profile address of 10 bit slave. Keeps it apart from 7 bit addresses.
+#define ESP_I2C_PROFILE_TEN(addr) ((uint16_t) ((addr) | 0x8000))
+// Check if profile address is 10 bit address.
+#define ESP_I2C_PROFILE_IS_TEN(addr) (((addr) & 0x8000) != 0)
+
+// Message flags.
+#define ESP_I2C_M_RD 0x0001         // Read data from slave to the buffer.
+#define ESP_I2C_M_TEN 0x0010        // The address is 10 bit address.
+#define ESP_I2C_M_IGNORE_NAK 0x1000 // Treat NACK from slave as ACK.
+#define ESP_I2C_M_NOSTART 0x4000    // Continue previous message without (repeated) START and address.
+
+// One segment of I2C transfer.
+typedef struct {
+  uint16_t address; // The 7 bit or 10 bit (ESP_I2C_M_TEN) slave address.
+  uint16_t flags;  // The ESP_I2C_M_* flags.
+  uint16_t len;    // The number of bytes to read or write.
+  uint8_t *buf;    // The data buffer.
+} esp_i2c_msg;
+
+// One segment of scatter-gather write.
+typedef struct {
+  const uint8_t *buf; // The data. May point to RAM or flash (ICACHE_RODATA_ATTR).
+  uint16_t len;       // The number of bytes.
+} esp_i2c_iovec;
+
+// Check if 7 bit address is reserved (0000 XXX and 1111 XXX).
+#define ESP_I2C_ADDR_RESERVED(addr) ((addr) < 0x08 || (addr) > 0x77)
+
+// Bitmap of 128 7 bit I2C addresses.
+typedef struct {
+  uint32_t map[4];
+} esp_i2c_addr_map;
+
+// Bitmap of 1024 10 bit I2C addresses.
+typedef struct {
+  uint32_t map[32];
+} esp_i2c_ten_map;
+
+// Set, clear and test address in the bitmap.
+#define ESP_I2C_MAP_SET(m, addr) ((m)->map[(addr) >> 5] |= (uint32_t) 0x1 << ((addr) & 0x1F))
+#define ESP_I2C_MAP_CLR(m, addr) ((m)->map[(addr) >> 5] &= ~((uint32_t) 0x1 << ((addr) & 0x1F)))
+#define ESP_I2C_MAP_HAS(m, addr) (((m)->map[(addr) >> 5] & ((uint32_t) 0x1 << ((addr) & 0x1F))) != 0)
+
+// Incremental bus scan.
+//
+// Each rescan probes all present addresses and window of
+// not present ones, so the whole address space is covered
+// in several calls.
+typedef struct {
+  esp_i2c_addr_map present; // Addresses of devices found on the bus.
+  esp_i2c_addr_map added;   // Addresses which appeared during last rescan.
+  esp_i2c_addr_map removed; // Addresses which disappeared during last rescan.
+  uint8_t window;           // Number of not present addresses to probe in one rescan.
+  uint8_t cursor;           // Next not present address to probe.
+  uint32_t probe_hz;        // Probe speed in Hz (0 - current bus speed).
+} esp_i2c_rescan;
+
+// Stream producer. Fills buf with up to len bytes and
+// returns the number of bytes produced (0 ends the stream).
+typedef uint16_t (*esp_i2c_producer)(void *arg, uint8_t *buf, uint16_t len);
+
+// Stream consumer. Receives len bytes read from the bus.
+typedef void (*esp_i2c_consumer)(void *arg, uint8_t *buf, uint16_t len);
+
 // Linked list node used when finding devices on the I2C bus.
 typedef struct esp_i2c_dev {
   uint8_t address;          // The I2C address.
@@ -52,147 +134,717 @@ typedef enum {
   ESP_I2C_ERR_NO_ACK,
   ESP_I2C_ERR_ROOT_NOT_NULL,
   ESP_I2C_ERR_DATA_CORRUPTED,
+  ESP_I2C_ERR_BUSY,
+  ESP_I2C_ERR_MEM,
+  ESP_I2C_ERR_BAD_ARG,
+  ESP_I2C_ERR_BUS_STUCK,
 } esp_i2c_err;
 
+// Get retry mask bit for the error code.
+#define ESP_I2C_RETRY_ON(err) ((uint16_t) (0x1 << (err)))
+
+// Transaction retry policy.
+typedef struct {
+  uint8_t retries;          // The maximum number of retries. Zero disables retrying.
+  uint16_t mask;            // The ESP_I2C_RETRY_ON mask of errors to retry.
+  uint16_t backoff_us;      // The base backoff before retry in microseconds.
+} esp_i2c_retry;
+
+// Asynchronous transaction states.
+typedef enum {
+  ESP_I2C_AS_IDLE,
+  ESP_I2C_AS_START,
+  ESP_I2C_AS_WRITE,
+  ESP_I2C_AS_READ,
+  ESP_I2C_AS_STOP,
+} esp_i2c_as_state;
+
+typedef struct esp_i2c_async esp_i2c_async;
+typedef struct esp_i2c_bus esp_i2c_bus;
+
+// Callback called when asynchronous transaction finishes.
+typedef void (*esp_i2c_async_cb)(esp_i2c_async *trans, esp_i2c_err err);
+
+// Asynchronous I2C transaction.
+//
+// Writes wr_len bytes from wr_buf and then, after repeated START,
+// reads rd_len bytes to rd_buf. Either part may be empty.
+// When both are empty the slave address is only probed.
+//
+// The transaction must stay valid till the callback is called.
+struct esp_i2c_async {
+  uint8_t address;          // The 7 bit slave address.
+  uint8_t *wr_buf;          // The bytes to write.
+  uint16_t wr_len;          // The number of bytes to write.
+  uint8_t *rd_buf;          // The buffer to read bytes to.
+  uint16_t rd_len;          // The number of bytes to read.
+  esp_i2c_async_cb cb;      // The completion callback.
+  void *custom;             // Custom data to associate with the transaction.
+
+  // Fields below are managed by the library.
+  esp_i2c_as_state state;   // The current state.
+  uint8_t phase;            // The phase of current bit or bus condition.
+  uint8_t byte;             // The byte being shifted.
+  uint8_t mask;             // The current bit mask (0 for ACK bit).
+  int32_t idx;              // The buffer index (-1 for address byte).
+  bool reading;             // Set when in read part of the transaction.
+  bool ack;                 // The ACK bit sent or received.
+  uint32_t cs_start;        // CPU cycle count when the clock was released.
+  bool cs_seen;             // Set when slave was seen stretching the clock.
+  esp_i2c_err err;          // The transaction result.
+  uint32_t busy_cycles;     // CPU cycles spent driving the bus.
+  uint32_t total_cycles;    // CPU cycles from submit to completion.
+  esp_i2c_bus *bus;         // The bus transaction was submitted to.
+  struct esp_i2c_async *next; // The next queued transaction.
+};
+
+// I2C bus statistics.
+typedef struct {
+  uint32_t arb_lost;        // The number of times arbitration was lost.
+  uint32_t retries;         // The number of retried transactions.
+  uint32_t cs_count;        // The number of clock stretches.
+  uint32_t cs_total_us;     // The total clock stretching time in microseconds.
+  uint32_t cs_max_us;       // The longest clock stretch in microseconds.
+  uint32_t cs_timeouts;     // The number of clock stretch timeouts.
+  uint32_t recoveries;      // The number of bus recoveries.
+  uint32_t crit_slots;      // The number of bit slots run with interrupts disabled.
+  uint32_t crit_skipped;    // The number of bit slots longer than interrupts off limit.
+} esp_i2c_stats;
+
+// Per device settings.
+//
+// Devices without profile use bus defaults.
+typedef struct {
+  uint16_t address;         // The 7 bit slave address or ESP_I2C_PROFILE_TEN(10 bit address).
+  uint32_t max_cs_us;       // The maximum clock stretch in microseconds (0 - bus default).
+  uint32_t cs_max_us;       // The longest clock stretch seen in microseconds.
+  uint32_t speed;           // The bus speed in Hz (0 - bus default).
+} esp_i2c_profile;
+
+// The shortest asynchronous engine tick os_timer can keep in microseconds.
+#define ESP_I2C_ASYNC_MIN_TICK_US 100
+
+// The length of queue of the task finishing transactions stepped from interrupt handler.
+#define ESP_I2C_ASYNC_QUEUE 4
+
+// Number of read-back checks at each speed during speed discovery.
+#define ESP_I2C_SPEED_CHECKS 8
+
+// I2C bus.
+//
+// Holds per bus state. Initialize with esp_i2c_bus_init
+// and do not modify the fields directly.
+struct esp_i2c_bus {
+  uint8_t gpio_scl;         // GPIO number assigned to clock.
+  uint8_t gpio_sda;         // GPIO number assigned to data.
+  uint32_t scl_mask;        // GPIO register mask for clock.
+  uint32_t sda_mask;        // GPIO register mask for data.
+  bool in_trans;            // In transaction when between START and STOP conditions.
+  uint32_t max_cs_us;       // Maximum time slave can stretch the clock in microseconds.
+  uint32_t cs_us;           // Maximum clock stretch for current device in microseconds.
+  uint32_t max_cs;          // Maximum clock stretch for current device in CPU cycles.
+  uint8_t cpu_mhz;          // The CPU frequency the cycle counts were computed for.
+  uint32_t speed;           // The bus speed in Hz.
+  uint32_t default_speed;   // The bus speed for devices without profile speed.
+  uint32_t overhead;        // CPU cycles spent on one bit outside of delays.
+  uint32_t delay_short;     // The short delay in CPU cycles.
+  uint32_t delay_long;      // The long delay in CPU cycles.
+  esp_i2c_async *async_head; // The asynchronous transactions queue.
+  esp_i2c_async *async_tail; // The last queued asynchronous transaction.
+  os_timer_t async_timer;   // The timer driving asynchronous engine.
+  uint32_t async_tick_us;   // The asynchronous engine tick in microseconds.
+  bool async_posted;        // Set when finished transaction was posted to the task.
+  esp_i2c_retry retry;      // The default transaction retry policy.
+  esp_i2c_stats stats;      // The bus statistics.
+  uint16_t ten_addr;        // The 10 bit address selected for write in current transaction.
+  esp_i2c_profile *profiles; // The device profiles.
+  uint8_t profiles_num;     // The number of device profiles.
+  esp_i2c_profile *profile; // The profile of current device or NULL.
+  uint16_t crit_max_us;     // Maximum interrupts off window in microseconds (0 - disabled).
+  uint32_t crit_max;        // Maximum interrupts off window in CPU cycles.
+};
+
 // Espressif SDK missing includes.
 void ets_isr_mask(unsigned intr);
 void ets_isr_unmask(unsigned intr);
+void ets_intr_lock();
+void ets_intr_unlock();
 
 /**
  * Initialize I2C bus.
  *
+ * Many buses may be initialized as long as they use different GPIOs.
+ *
+ * @param bus          The I2C bus to initialize.
  * @param scl_gpio_num The GPIO number to use for clock.
  * @param sda_gpio_num The GPIO number to use for data.
  *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_init(uint8_t scl_gpio_num, uint8_t sda_gpio_num);
+esp_i2c_bus_init(esp_i2c_bus *bus, uint8_t scl_gpio_num, uint8_t sda_gpio_num);
 
 /**
- * Set I2C bus speed.
+ * Set maximum time slave can stretch the clock.
  *
- * @param speed The one of ESP_I2C_SPEED_* defines.
+ * The timeout does not depend on CPU frequency. Devices with profile
+ * set by esp_i2c_bus_set_profiles may have different timeout.
+ *
+ * @param bus    The I2C bus.
+ * @param max_us The maximum clock stretch in microseconds.
  */
 void ICACHE_FLASH_ATTR
-esp_i2c_set_speed(uint8_t speed);
+esp_i2c_bus_set_max_stretch(esp_i2c_bus *bus, uint32_t max_us);
+
+/**
+ * Set per device profiles.
+ *
+ * The profile is selected every time the address is sent to the bus.
+ * The table is owned by the caller and must stay valid.
+ *
+ * @param bus      The I2C bus.
+ * @param profiles The device profiles.
+ * @param num      The number of profiles.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_set_profiles(esp_i2c_bus *bus, esp_i2c_profile *profiles, uint8_t num);
+
+/**
+ * Set I2C bus speed.
+ *
+ * Bit timing is measured in CPU cycles so the function must be
+ * called again after changing CPU frequency. Devices with profile
+ * speed switch the bus to their speed.
+ *
+ * @param bus     The I2C bus.
+ * @param freq_hz The SCL frequency in Hz (up to 1MHz) or one of ESP_I2C_SPEED_* defines.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_BAD_ARG when freq_hz is zero.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_set_speed(esp_i2c_bus *bus, uint32_t freq_hz);
+
+/**
+ * Calibrate bit timing and measure SCL frequency.
+ *
+ * Measures number of CPU cycles spent on each bit outside of delays
+ * and compensates for it. Then clocks the bus at the default speed
+ * (set with esp_i2c_bus_set_speed) and reports SCL frequency actually
+ * reached. On failure bit timing is restored and the bus released.
+ *
+ * SCL is toggled while SDA stays released so slaves do not see
+ * START condition. Must be called outside of a transaction.
+ *
+ * @param bus    The I2C bus.
+ * @param scl_hz The measured SCL frequency in Hz.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_calibrate(esp_i2c_bus *bus, uint32_t *scl_hz);
 
 /**
  * Send start condition to I2C bus.
  *
  * It also initializes clock to known initial state.
  *
+ * @param bus The I2C bus.
+ *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_start();
+esp_i2c_bus_start(esp_i2c_bus *bus);
 
 /**
  * Send stop condition to I2C bus.
  *
+ * @param bus The I2C bus.
+ *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_stop();
+esp_i2c_bus_stop(esp_i2c_bus *bus);
 
 /**
  * Release SCL and SDA on fatal error.
  *
+ * Placed in IRAM since asynchronous engine calls it from
+ * esp_i2c_bus_async_isr_step.
+ *
+ * @param bus The I2C bus.
  * @param err The I2C error code to return.
  *
  * @return The I2C error code.
  */
-esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_fail_fast(esp_i2c_err err);
+esp_i2c_err
+esp_i2c_bus_fail_fast(esp_i2c_bus *bus, esp_i2c_err err);
 
 /**
  * Write byte to I2C bus.
  *
+ * @param bus      The I2C bus.
  * @param byte     The byte to write.
  * @param ack_resp The response after sending 8th bit (ESP_I2C_ACK or ESP_I2C_NACK).
  *
  * @return The I2C error code.
  */
-esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_write_byte(uint8_t byte, bool *ack_resp);
+esp_i2c_err ESP_I2C_BIT_ATTR
+esp_i2c_bus_write_byte(esp_i2c_bus *bus, uint8_t byte, bool *ack_resp);
 
 /**
  * Read byte from I2C bus.
  *
+ * @param bus      The I2C bus.
  * @param dst      The destination buffer.
  * @param ack_type The ESP_I2C_ACK or ESP_I2C_NACK to send after receiving the byte.
  *
  * @return The I2C error code.
  */
-esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_read_byte(uint8_t *dst, bool ack_type);
+esp_i2c_err ESP_I2C_BIT_ATTR
+esp_i2c_bus_read_byte(esp_i2c_bus *bus, uint8_t *dst, bool ack_type);
 
 /**
  * Write bytes to I2C bytes.
  *
+ * @param bus The I2C bus.
  * @param buf The data to write.
- * @param len  The number of bytes to write.
+ * @param len The number of bytes to write.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_write_bytes(esp_i2c_bus *bus, uint8_t *buf, uint16_t len);
+
+/**
+ * Write segments to I2C bus back to back.
+ *
+ * Segments are sent without copying to intermediate buffer. Data is
+ * read with aligned 32 bit loads so buffers may be placed in flash.
+ *
+ * Example:
+ *
+ *   esp_i2c_iovec iov[] = {{header, 2}, {payload, payload_len}};
+ *
+ *   esp_i2c_bus_start_read_write(&bus, ESP_I2C_ADDR_WRITE(0x50), true);
+ *   esp_i2c_bus_write_iov(&bus, iov, 2);
+ *   esp_i2c_bus_stop(&bus);
+ *
+ * @param bus The I2C bus.
+ * @param iov The array of segments.
+ * @param num The number of segments.
  *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_write_bytes(uint8_t *buf, uint8_t len);
+esp_i2c_bus_write_iov(esp_i2c_bus *bus, const esp_i2c_iovec *iov, uint8_t num);
 
 /**
  * Read bytes from I2C bus.
  *
  * ESP_I2C_NACK is send after last byte.
  *
+ * @param bus The I2C bus.
  * @param buf The buffer to read data to.
  * @param len The number of bytes to read.
  *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_read_bytes(uint8_t *buf, uint8_t len);
+esp_i2c_bus_read_bytes(esp_i2c_bus *bus, uint8_t *buf, uint16_t len);
+
+/**
+ * Write stream of bytes to I2C bus.
+ *
+ * Calls producer to fill the chunk buffer and writes returned
+ * number of bytes till producer returns 0. All chunks are written
+ * within current transaction so no full size buffer is needed.
+ *
+ * @param bus       The I2C bus.
+ * @param chunk     The chunk buffer.
+ * @param chunk_len The chunk buffer size.
+ * @param producer  The chunk producer.
+ * @param arg       The argument passed to producer.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_write_stream(esp_i2c_bus *bus,
+                         uint8_t *chunk,
+                         uint16_t chunk_len,
+                         esp_i2c_producer producer,
+                         void *arg);
+
+/**
+ * Read stream of bytes from I2C bus.
+ *
+ * Reads total bytes chunk by chunk within current transaction
+ * and passes each chunk to consumer. ESP_I2C_NACK is send after
+ * the last byte of the stream.
+ *
+ * @param bus       The I2C bus.
+ * @param chunk     The chunk buffer.
+ * @param chunk_len The chunk buffer size.
+ * @param total     The number of bytes to read.
+ * @param consumer  The chunk consumer.
+ * @param arg       The argument passed to consumer.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_BAD_ARG when chunk_len is zero.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_read_stream(esp_i2c_bus *bus,
+                        uint8_t *chunk,
+                        uint16_t chunk_len,
+                        uint32_t total,
+                        esp_i2c_consumer consumer,
+                        void *arg);
 
 /**
  * Start reading or writing process. Expect address with read/write bit already set.
  *
+ * @param bus          The I2C bus.
  * @param address      The I2C address with read/write bit already set.
  * @param stop_on_nack Send stop after getting ESP_I2C_NACK.
  *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_start_read_write(uint8_t address, bool stop_on_nack);
+esp_i2c_bus_start_read_write(esp_i2c_bus *bus, uint8_t address, bool stop_on_nack);
 
 /**
  * Start writing to the slave.
  *
+ * @param bus     The I2C bus.
  * @param address The slave address.
  * @param reg     The register address to write to.
  *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_start_write(uint8_t address, uint8_t reg);
+esp_i2c_bus_start_write(esp_i2c_bus *bus, uint8_t address, uint8_t reg);
 
 /**
  * Start reading from the slave.
  *
+ * @param bus     The I2C bus.
  * @param address The slave address.
  * @param reg     The register address to read from.
  *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_start_read(uint8_t address, uint8_t reg);
+esp_i2c_bus_start_read(esp_i2c_bus *bus, uint8_t address, uint8_t reg);
+
+/**
+ * Start reading or writing process with 10 bit slave address.
+ *
+ * Writing sends both address bytes. Reading from the slave selected
+ * for writing earlier in the same transaction uses the short form:
+ * repeated START and the first address byte only. Otherwise the full
+ * form is used: both address bytes for writing followed by repeated
+ * START and the first address byte for reading.
+ *
+ * @param bus          The I2C bus.
+ * @param address      The 10 bit slave address.
+ * @param read         Start reading if true, writing otherwise.
+ * @param stop_on_nack Send stop after getting ESP_I2C_NACK.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_start_ten(esp_i2c_bus *bus, uint16_t address, bool read, bool stop_on_nack);
+
+/**
+ * Recover the bus from slave holding SDA low.
+ *
+ * Clocks SCL up to nine times until the slave releases SDA,
+ * then sends STOP and resets the bus transaction state.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_BUS_STUCK if SDA stays low.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_recover(esp_i2c_bus *bus);
+
+/**
+ * Set transaction retry policy.
+ *
+ * Transaction failing with error in the mask is retried after
+ * a random backoff between half and full backoff window.
+ * The window starts at backoff_us and doubles with every retry.
+ * If after the backoff SDA is held low the bus is recovered
+ * with esp_i2c_bus_recover before the next attempt.
+ *
+ * By default lost arbitration and SDA held low before START
+ * (ESP_I2C_ERR_BUS_STUCK) are retried 3 times with 50us backoff.
+ * The policy may be overridden for one transfer with
+ * esp_i2c_bus_transfer_retry.
+ *
+ * Example:
+ *
+ *   esp_i2c_bus_set_retry(&bus, 3, ESP_I2C_RETRY_ON(ESP_I2C_ERR_ARB_LOST) |
+ *                                  ESP_I2C_RETRY_ON(ESP_I2C_ERR_LONG_STRETCH), 50);
+ *
+ * @param bus        The I2C bus.
+ * @param retries    The maximum number of retries. Zero disables retrying.
+ * @param mask       The ESP_I2C_RETRY_ON mask of errors to retry.
+ * @param backoff_us The base backoff in microseconds.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_set_retry(esp_i2c_bus *bus, uint8_t retries, uint16_t mask, uint16_t backoff_us);
+
+/**
+ * Reset bus statistics.
+ *
+ * @param bus The I2C bus.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_reset_stats(esp_i2c_bus *bus);
+
+/**
+ * Run high phase of bit slots with interrupts disabled.
+ *
+ * Interrupt landing while SCL is high stretches the high phase.
+ * SMBus devices may treat SCL and SDA high for more than 50us as
+ * bus idle. The window starts after slave releases the clock so
+ * clock stretching is never waited for with interrupts disabled.
+ * Slots with window longer than max_us (slow bus speeds) run with
+ * interrupts enabled and are counted in bus->stats.crit_skipped.
+ *
+ * @param bus    The I2C bus.
+ * @param max_us The maximum interrupts off window in microseconds. Zero disables.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_bus_set_crit(esp_i2c_bus *bus, uint16_t max_us);
+
+/**
+ * Execute list of messages in one bus session.
+ *
+ * Messages are joined with repeated START (unless ESP_I2C_M_NOSTART is set)
+ * and the single STOP is sent after the last message. When reading,
+ * ESP_I2C_NACK is send after the last byte unless the next message
+ * continues reading with ESP_I2C_M_NOSTART.
+ *
+ * Transfer is retried according to esp_i2c_bus_set_retry policy.
+ *
+ * @param bus  The I2C bus.
+ * @param msgs The array of messages.
+ * @param num  The number of messages.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_transfer(esp_i2c_bus *bus, esp_i2c_msg *msgs, uint8_t num);
+
+/**
+ * Execute list of messages with its own retry policy.
+ *
+ * Same as esp_i2c_bus_transfer but the retry policy overrides the bus
+ * default set with esp_i2c_bus_set_retry for this set of messages.
+ *
+ * Example:
+ *
+ *   // Sensor trigger must not be sent twice.
+ *   esp_i2c_retry once = {0, 0, 0};
+ *   esp_i2c_bus_transfer_retry(&bus, msgs, 2, &once);
+ *
+ * @param bus   The I2C bus.
+ * @param msgs  The array of messages.
+ * @param num   The number of messages.
+ * @param retry The retry policy or NULL for the bus default.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_transfer_retry(esp_i2c_bus *bus, esp_i2c_msg *msgs, uint8_t num, const esp_i2c_retry *retry);
 
 /**
  * Scan I2C bus for devices.
  *
+ * @param bus  The I2C bus.
  * @param root The root of linked list of found devices. Must be NULL initially.
  *
  * @return The I2C error code.
  */
 esp_i2c_err ICACHE_FLASH_ATTR
-esp_i2c_scan(esp_i2c_dev **root);
+esp_i2c_bus_scan(esp_i2c_bus *bus, esp_i2c_dev **root);
+
+/**
+ * Probe slave address.
+ *
+ * @param bus     The I2C bus.
+ * @param address The 7 bit slave address.
+ *
+ * @return ESP_I2C_OK if slave acknowledged its address, error code otherwise.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_probe(esp_i2c_bus *bus, uint8_t address);
+
+/**
+ * Scan I2C bus for devices without allocating memory.
+ *
+ * @param bus      The I2C bus.
+ * @param found    The bitmap of found addresses.
+ * @param probe_hz The speed to probe addresses with (0 - current bus speed).
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_scan_map(esp_i2c_bus *bus, esp_i2c_addr_map *found, uint32_t probe_hz);
+
+/**
+ * Find the highest speed device works reliably at.
+ *
+ * The register is read at 100kHz and then ESP_I2C_SPEED_CHECKS times at
+ * each speed from the list. Discovery stops at the first speed with error
+ * or different value and the last good speed is stored in the device
+ * profile. The device must have profile set with esp_i2c_bus_set_profiles.
+ *
+ * Speeds above the fastest bit timing of calibrated bus are tried and
+ * stored as that speed. Transfers are not retried. Lost arbitration or
+ * stuck bus end the discovery with the last good speed stored.
+ *
+ * @param bus     The I2C bus.
+ * @param address The 7 bit slave address or ESP_I2C_PROFILE_TEN(10 bit address).
+ * @param reg     The register with constant value (for example device ID).
+ * @param speeds  The speeds to try in ascending order (NULL - 200kHz to 1MHz).
+ * @param num     The number of speeds.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_BAD_ARG if device has no profile.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_discover_speed(esp_i2c_bus *bus, uint16_t address, uint8_t reg, const uint32_t *speeds, uint8_t num);
+
+/**
+ * Probe 10 bit slave address.
+ *
+ * @param bus     The I2C bus.
+ * @param address The 10 bit slave address.
+ *
+ * @return ESP_I2C_OK if slave acknowledged its address, error code otherwise.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_probe_ten(esp_i2c_bus *bus, uint16_t address);
+
+/**
+ * Scan I2C bus for devices with 10 bit addresses.
+ *
+ * The first address byte is probed alone first so the ranges
+ * of 256 addresses no device responds to are skipped.
+ *
+ * @param bus      The I2C bus.
+ * @param found    The bitmap of found addresses.
+ * @param probe_hz The speed to probe addresses with (0 - current bus speed).
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_scan_ten(esp_i2c_bus *bus, esp_i2c_ten_map *found, uint32_t probe_hz);
+
+/**
+ * Probe present addresses and a window of not present ones.
+ *
+ * Updates present, added and removed bitmaps. The rescan structure must
+ * be zeroed and have window and probe_hz set before first call. Window
+ * of 0 only checks for removed devices, window of 128 rescans the whole bus.
+ *
+ * @param bus The I2C bus.
+ * @param rs  The incremental scan state.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_rescan(esp_i2c_bus *bus, esp_i2c_rescan *rs);
+
+/**
+ * Set asynchronous engine tick period.
+ *
+ * Each tick advances the bus by a quarter of a bit so the bus
+ * frequency is 1 / (4 * tick_us), about 2.5 kHz at the default
+ * 100 us tick. The engine uses microsecond os_timer so
+ * system_timer_reinit() must be called in user_init. The os_timer
+ * can not keep ticks shorter than ESP_I2C_ASYNC_MIN_TICK_US.
+ *
+ * When set to 0 no timer is used and the caller must drive the
+ * engine by calling esp_i2c_bus_async_step from task context or
+ * esp_i2c_bus_async_isr_step from hardware timer (FRC1) interrupt.
+ *
+ * @param bus     The I2C bus.
+ * @param tick_us The tick period in microseconds (0 or at least ESP_I2C_ASYNC_MIN_TICK_US).
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_async_set_tick(esp_i2c_bus *bus, uint32_t tick_us);
+
+/**
+ * Submit asynchronous transaction.
+ *
+ * Transactions are queued and executed in order they were submitted.
+ * Synchronous calls must not be made till the queue is empty.
+ *
+ * @param bus   The I2C bus.
+ * @param trans The transaction.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_async_submit(esp_i2c_bus *bus, esp_i2c_async *trans);
+
+/**
+ * Advance asynchronous engine by one tick.
+ *
+ * Must be called from task context, not from interrupt handler.
+ * Calls the completion callback when transaction is finished.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return true if there are more ticks to process, false otherwise.
+ */
+bool ICACHE_FLASH_ATTR
+esp_i2c_bus_async_step(esp_i2c_bus *bus);
+
+/**
+ * Register the task finishing transactions stepped from interrupt handler.
+ *
+ * Must be called once before esp_i2c_bus_async_isr_step is used.
+ *
+ * @param prio The user task priority (USER_TASK_PRIO_0 - USER_TASK_PRIO_2).
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_async_isr_init(uint8_t prio);
+
+/**
+ * Advance asynchronous engine by one tick from interrupt handler.
+ *
+ * Placed in IRAM so it may be called from hardware timer (FRC1)
+ * interrupt handler which allows ticks shorter than os_timer can
+ * keep. Only the bus is driven in the interrupt, the finished
+ * transaction is posted to the task registered with
+ * esp_i2c_async_isr_init which calls the completion callback and
+ * starts the next queued transaction.
+ *
+ * The tick must be set to 0 with esp_i2c_bus_async_set_tick and the
+ * transaction buffers must be in RAM.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return true if current transaction has more ticks to process, false otherwise.
+ */
+bool
+esp_i2c_bus_async_isr_step(esp_i2c_bus *bus);
+
+/**
+ * Check if asynchronous engine has pending transactions.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return true if busy, false otherwise.
+ */
+bool ICACHE_FLASH_ATTR
+esp_i2c_bus_async_busy(esp_i2c_bus *bus);
 
 /**
  * Free memory allocated for device list returned from esp_i2c_scan.
@@ -203,4 +855,89 @@ esp_i2c_scan(esp_i2c_dev **root);
 void ICACHE_FLASH_ATTR
 esp_i2c_free_device_list(esp_i2c_dev *root, bool free_custom);
 
+/**
+ * Initialize default I2C bus.
+ *
+ * The default bus is used by all functions not taking esp_i2c_bus argument.
+ * Calling it again with different GPIOs returns ESP_I2C_ERR_INIT_CONFLICT.
+ *
+ * @param scl_gpio_num The GPIO number to use for clock.
+ * @param sda_gpio_num The GPIO number to use for data.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_init(uint8_t scl_gpio_num, uint8_t sda_gpio_num);
+
+/**
+ * Get default I2C bus.
+ *
+ * @return The bus initialized with esp_i2c_init.
+ */
+esp_i2c_bus *ICACHE_FLASH_ATTR
+esp_i2c_default_bus();
+
+// Functions below operate on the default bus. See
+// their esp_i2c_bus_* counterparts for documentation.
+
+void ICACHE_FLASH_ATTR
+esp_i2c_set_max_stretch(uint32_t max_us);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_set_speed(uint32_t freq_hz);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_calibrate(uint32_t *scl_hz);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_start();
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_stop();
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_fail_fast(esp_i2c_err err);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_write_byte(uint8_t byte, bool *ack_resp);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_read_byte(uint8_t *dst, bool ack_type);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_write_bytes(uint8_t *buf, uint16_t len);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_read_bytes(uint8_t *buf, uint16_t len);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_start_read_write(uint8_t address, bool stop_on_nack);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_start_write(uint8_t address, uint8_t reg);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_start_read(uint8_t address, uint8_t reg);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_transfer(esp_i2c_msg *msgs, uint8_t num);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_scan(esp_i2c_dev **root);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_async_set_tick(uint32_t tick_us);
+
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_async_submit(esp_i2c_async *trans);
+
+bool ICACHE_FLASH_ATTR
+esp_i2c_async_step();
+
+bool
+esp_i2c_async_isr_step();
+
+bool ICACHE_FLASH_ATTR
+esp_i2c_async_busy();
+
 #endif //ESP_I2C_H
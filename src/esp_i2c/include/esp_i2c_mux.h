@@ -0,0 +1,181 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_I2C_MUX_H
+#define ESP_I2C_MUX_H
+
+#include <esp_i2c.h>
+
+// TCA9548A / PCA9548 address range.
+#define ESP_I2C_MUX_ADDR_MIN 0x70
+#define ESP_I2C_MUX_ADDR_MAX 0x77
+// Bit for the multiplexer address in esp_i2c_mux_scan mask.
+#define ESP_I2C_MUX_ADDR_BIT(address) ((uint8_t) (0x1 << ((address) - ESP_I2C_MUX_ADDR_MIN)))
+// All addresses in the multiplexer range.
+#define ESP_I2C_MUX_ADDR_ALL 0xFF
+
+// Number of channels.
+#define ESP_I2C_MUX_CHANNELS 8
+// Maximum number of nested multiplexers.
+#define ESP_I2C_MUX_MAX_DEPTH 4
+
+// 8 channel I2C multiplexer.
+//
+// The control register value is cached so selecting already
+// active channel does not go to the bus.
+typedef struct esp_i2c_mux esp_i2c_mux;
+struct esp_i2c_mux {
+  esp_i2c_bus *bus;         // The I2C bus.
+  uint8_t address;          // The 7 bit multiplexer address.
+  esp_i2c_mux *parent;      // The upstream multiplexer or NULL.
+  uint8_t parent_channel;   // The upstream multiplexer channel.
+  uint8_t ctrl;             // The cached control register.
+  bool cached;              // Set when ctrl value is known.
+  uint32_t switches;        // The number of control register writes.
+  uint32_t skipped;         // The number of skipped control register writes.
+};
+
+// Device behind multiplexer.
+typedef struct {
+  esp_i2c_mux *mux;         // The multiplexer or NULL for device on the bus.
+  uint8_t channel;          // The multiplexer channel.
+  uint8_t address;          // The 7 bit slave address.
+} esp_i2c_mux_dev;
+
+// Bus topology.
+//
+// Tables of multiplexers and devices are provided by the caller.
+typedef struct {
+  esp_i2c_bus *bus;         // The I2C bus.
+  esp_i2c_mux *muxes;       // The multiplexers table.
+  uint8_t muxes_max;        // The multiplexers table size.
+  uint8_t muxes_num;        // The number of multiplexers.
+  esp_i2c_mux_dev *devs;    // The devices table.
+  uint16_t devs_max;        // The devices table size.
+  uint16_t devs_num;        // The number of devices.
+  uint8_t mux_mask;         // The addresses to probe for multiplexers.
+} esp_i2c_mux_topo;
+
+/**
+ * Initialize multiplexer.
+ *
+ * @param mux            The multiplexer.
+ * @param bus            The I2C bus.
+ * @param address        The 7 bit multiplexer address.
+ * @param parent         The upstream multiplexer or NULL.
+ * @param parent_channel The upstream multiplexer channel.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_mux_init(esp_i2c_mux *mux, esp_i2c_bus *bus, uint8_t address, esp_i2c_mux *parent, uint8_t parent_channel);
+
+/**
+ * Select multiplexer channel.
+ *
+ * Upstream multiplexers are switched first. The control register
+ * write is skipped when the channel is already active.
+ *
+ * @param mux     The multiplexer.
+ * @param channel The channel (0 - 7).
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_select(esp_i2c_mux *mux, uint8_t channel);
+
+/**
+ * Disable all multiplexer channels.
+ *
+ * @param mux The multiplexer.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_disable(esp_i2c_mux *mux);
+
+/**
+ * Forget cached control register (for example after multiplexer reset).
+ *
+ * @param mux The multiplexer.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_mux_invalidate(esp_i2c_mux *mux);
+
+/**
+ * Initialize topology.
+ *
+ * @param topo      The topology.
+ * @param bus       The I2C bus.
+ * @param muxes     The multiplexers table.
+ * @param muxes_max The multiplexers table size.
+ * @param devs      The devices table.
+ * @param devs_max  The devices table size.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_mux_topo_init(esp_i2c_mux_topo *topo,
+                      esp_i2c_bus *bus,
+                      esp_i2c_mux *muxes,
+                      uint8_t muxes_max,
+                      esp_i2c_mux_dev *devs,
+                      uint16_t devs_max);
+
+/**
+ * Scan the bus and all multiplexer channels.
+ *
+ * Multiplexers are detected by writing and reading back the control
+ * register. Only addresses declared in mux_mask are probed because
+ * other devices in ESP_I2C_MUX_ADDR_MIN - ESP_I2C_MUX_ADDR_MAX range
+ * (BMP280, BME280, HT16K33) would have their registers overwritten.
+ * Devices visible upstream are not repeated for downstream channels.
+ * All multiplexers are disabled after the scan.
+ *
+ * @param topo     The topology.
+ * @param mux_mask The ESP_I2C_MUX_ADDR_BIT of every address which is
+ *                 a multiplexer. Zero scans devices only.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_MEM when tables are too small.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_scan(esp_i2c_mux_topo *topo, uint8_t mux_mask);
+
+/**
+ * Make the device reachable.
+ *
+ * Selects channels on the path to the device and disables other
+ * multiplexers which could expose devices with the same address.
+ *
+ * @param topo The topology.
+ * @param dev  The device.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_dev_select(esp_i2c_mux_topo *topo, esp_i2c_mux_dev *dev);
+
+/**
+ * Select the device and execute list of messages.
+ *
+ * @param topo The topology.
+ * @param dev  The device.
+ * @param msgs The array of messages.
+ * @param num  The number of messages.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_mux_transfer(esp_i2c_mux_topo *topo, esp_i2c_mux_dev *dev, esp_i2c_msg *msgs, uint8_t num);
+
+#endif //ESP_I2C_MUX_H
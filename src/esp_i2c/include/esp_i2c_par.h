@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_I2C_PAR_H
+#define ESP_I2C_PAR_H
+
+#include <esp_i2c.h>
+
+// Maximum number of SDA lanes.
+#define ESP_I2C_PAR_MAX_LANES 8
+
+// Parallel I2C.
+//
+// Many identical devices with the same address, each one on its own
+// SDA line, sharing one SCL line. All lanes are written and sampled
+// at the same clock edge so N devices are accessed in the time of one.
+typedef struct {
+  esp_i2c_bus *bus;         // The bus providing SCL line and timing.
+  uint8_t lanes;            // The number of SDA lanes.
+  uint32_t lane_mask[ESP_I2C_PAR_MAX_LANES]; // GPIO register mask for each lane.
+  uint32_t sda_mask;        // GPIO register mask for all lanes.
+} esp_i2c_par;
+
+/**
+ * Initialize parallel I2C.
+ *
+ * @param par       The parallel I2C to initialize.
+ * @param bus       The initialized I2C bus. Its SCL is shared by all lanes.
+ * @param sda_gpios The array of SDA GPIO numbers.
+ * @param lanes     The number of lanes (up to ESP_I2C_PAR_MAX_LANES).
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_par_init(esp_i2c_par *par, esp_i2c_bus *bus, uint8_t *sda_gpios, uint8_t lanes);
+
+/**
+ * Write and then read the same data on all lanes in one bus session.
+ *
+ * Writes wr_len bytes to all devices and then, after repeated START,
+ * reads rd_len bytes from each device. Read data is stored lane by lane:
+ * byte i from lane l is at rd_buf[l * rd_len + i].
+ *
+ * The lane is marked as acknowledged when its device acknowledged
+ * all addresses and written bytes. Data read from not acknowledged
+ * lanes is undefined.
+ *
+ * @param par     The parallel I2C.
+ * @param address The 7 bit slave address.
+ * @param wr_buf  The bytes to write to all devices.
+ * @param wr_len  The number of bytes to write.
+ * @param rd_buf  The buffer for lanes * rd_len bytes.
+ * @param rd_len  The number of bytes to read from each device.
+ * @param acks    The bitmask of lanes which acknowledged (bit 0 - lane 0).
+ *
+ * @return The I2C error code. ESP_I2C_ERR_NO_ACK when no lane acknowledged.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_par_transfer(esp_i2c_par *par,
+                     uint8_t address,
+                     uint8_t *wr_buf,
+                     uint8_t wr_len,
+                     uint8_t *rd_buf,
+                     uint8_t rd_len,
+                     uint8_t *acks);
+
+#endif //ESP_I2C_PAR_H
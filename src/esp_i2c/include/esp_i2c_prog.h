@@ -0,0 +1,97 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_I2C_PROG_H
+#define ESP_I2C_PROG_H
+
+#include <esp_i2c.h>
+
+// Step flags.
+#define ESP_I2C_STEP_CHK_CS 0x01   // Wait for clock stretching (SCL released in this step).
+#define ESP_I2C_STEP_CHK_ACK 0x02  // Sample SDA and abort when slave did not acknowledge.
+#define ESP_I2C_STEP_CHK_IDLE 0x04 // Check SDA is high before START.
+#define ESP_I2C_STEP_CHK_ARB 0x08  // Check SDA is high while SCL is high (arbitration).
+
+// Number of steps needed for START or STOP.
+#define ESP_I2C_PROG_COND_STEPS 4
+// Maximum number of steps needed for one byte with ACK.
+#define ESP_I2C_PROG_BYTE_STEPS 36
+// Number of steps needed to compile write of len bytes to register.
+#define ESP_I2C_PROG_WRITE_STEPS(len) (2 * ESP_I2C_PROG_COND_STEPS + ((len) + 2) * ESP_I2C_PROG_BYTE_STEPS)
+
+// One step of compiled transaction.
+typedef struct {
+  uint32_t set;             // GPIO mask written to GPIO_OUT_EN_S (lines driven low).
+  uint32_t clr;             // GPIO mask written to GPIO_OUT_EN_C (lines released).
+  uint32_t delay;           // CPU cycles to wait after the step.
+  uint8_t flags;            // The ESP_I2C_STEP_* flags.
+} esp_i2c_step;
+
+// Compiled transaction.
+//
+// The whole transaction precomputed as a list of GPIO edges
+// and delays replayed with esp_i2c_prog_run.
+typedef struct {
+  esp_i2c_step *steps;      // The array of steps.
+  uint16_t size;            // The capacity of steps array.
+  uint16_t len;             // The number of used steps.
+  uint8_t address;          // The 7 bit slave address the steps were compiled for.
+} esp_i2c_prog;
+
+/**
+ * Initialize compiled transaction.
+ *
+ * @param prog  The compiled transaction.
+ * @param steps The array for steps.
+ * @param size  The number of elements in steps array.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_prog_init(esp_i2c_prog *prog, esp_i2c_step *steps, uint16_t size);
+
+/**
+ * Compile write to the register.
+ *
+ * Compiles START, slave address, register, payload and STOP. Delays
+ * are taken from the speed of the device profile for the address (or
+ * the default bus speed) so transaction must be compiled again after
+ * speed or profile change. Use ESP_I2C_PROG_WRITE_STEPS to calculate
+ * needed steps array size.
+ *
+ * @param bus     The I2C bus.
+ * @param prog    The compiled transaction.
+ * @param address The 7 bit slave address.
+ * @param reg     The register address.
+ * @param buf     The data to write.
+ * @param len     The number of bytes to write.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_MEM when steps array is too small.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_prog_write(esp_i2c_bus *bus, esp_i2c_prog *prog, uint8_t address, uint8_t reg, uint8_t *buf, uint16_t len);
+
+/**
+ * Execute compiled transaction.
+ *
+ * @param bus  The I2C bus the transaction was compiled for.
+ * @param prog The compiled transaction.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ESP_I2C_BIT_ATTR
+esp_i2c_prog_run(esp_i2c_bus *bus, esp_i2c_prog *prog);
+
+#endif //ESP_I2C_PROG_H
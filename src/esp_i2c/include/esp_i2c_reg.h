@@ -0,0 +1,179 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_I2C_REG_H
+#define ESP_I2C_REG_H
+
+#include <esp_i2c.h>
+
+// Register map flags.
+#define ESP_I2C_REG_ADDR16 0x01   // Device uses 16 bit register addresses (MSB first).
+#define ESP_I2C_REG_BE 0x02       // Multi byte values are big endian.
+
+// Shadow cache register states.
+#define ESP_I2C_REG_VALID 0x01    // Cached value is known.
+#define ESP_I2C_REG_DIRTY 0x02    // Cached value not written to the device yet.
+
+// Maximum number of register runs written by one flush transfer.
+#define ESP_I2C_REG_FLUSH_RUNS 8
+// Maximum number of clean registers merged into a flush run
+// instead of starting a new one.
+#define ESP_I2C_REG_FLUSH_GAP 2
+
+// Register map of I2C device.
+//
+// Registers are 8 bit wide and multi byte values span
+// consecutive registers read and written with address
+// auto increment.
+//
+// Optional shadow cache keeps values of a range of
+// registers (usually write-only or rarely changing
+// configuration registers) so read-modify-write
+// does not have to go to the bus.
+typedef struct {
+  esp_i2c_bus *bus;         // The I2C bus.
+  uint8_t address;          // The 7 bit slave address.
+  uint8_t flags;            // The ESP_I2C_REG_* flags.
+  uint16_t cache_base;      // The first cached register.
+  uint16_t cache_len;       // The number of cached registers.
+  uint8_t *cache;           // Cached register values.
+  uint8_t *state;           // Cached register states.
+} esp_i2c_regmap;
+
+/**
+ * Initialize register map.
+ *
+ * @param map     The register map.
+ * @param bus     The I2C bus.
+ * @param address The 7 bit slave address.
+ * @param flags   The ESP_I2C_REG_* flags.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_reg_init(esp_i2c_regmap *map, esp_i2c_bus *bus, uint8_t address, uint8_t flags);
+
+/**
+ * Setup shadow cache for range of registers.
+ *
+ * All cached registers start as not valid.
+ *
+ * @param map    The register map.
+ * @param base   The first register to cache.
+ * @param len    The number of registers to cache.
+ * @param values The buffer for len register values.
+ * @param state  The buffer for len register states.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_reg_cache(esp_i2c_regmap *map, uint16_t base, uint16_t len, uint8_t *values, uint8_t *state);
+
+/**
+ * Mark all cached registers as not valid.
+ *
+ * Call after device reset. Not flushed changes are lost.
+ *
+ * @param map The register map.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_reg_invalidate(esp_i2c_regmap *map);
+
+/**
+ * Burst read registers.
+ *
+ * When all registers are cached and valid the bus is not used.
+ *
+ * @param map The register map.
+ * @param reg The first register.
+ * @param buf The buffer to read values to.
+ * @param len The number of registers to read.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_read(esp_i2c_regmap *map, uint16_t reg, uint8_t *buf, uint16_t len);
+
+/**
+ * Burst write registers.
+ *
+ * Cached registers are updated and marked clean.
+ *
+ * @param map The register map.
+ * @param reg The first register.
+ * @param buf The values to write.
+ * @param len The number of registers to write.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_write(esp_i2c_regmap *map, uint16_t reg, uint8_t *buf, uint16_t len);
+
+/**
+ * Read multi byte value.
+ *
+ * @param map   The register map.
+ * @param reg   The first register.
+ * @param width The value width in bytes (1 - 4).
+ * @param val   The value.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_read_val(esp_i2c_regmap *map, uint16_t reg, uint8_t width, uint32_t *val);
+
+/**
+ * Write multi byte value.
+ *
+ * @param map   The register map.
+ * @param reg   The first register.
+ * @param width The value width in bytes (1 - 4).
+ * @param val   The value.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_write_val(esp_i2c_regmap *map, uint16_t reg, uint8_t width, uint32_t val);
+
+/**
+ * Update bits of cached register.
+ *
+ * The register is read from the device only when its cached value
+ * is not valid. Changed register is marked dirty and written to the
+ * device by esp_i2c_reg_flush. Not cached registers are read and
+ * written immediately.
+ *
+ * @param map   The register map.
+ * @param reg   The register.
+ * @param mask  The bits to update.
+ * @param value The new value of bits.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_update(esp_i2c_regmap *map, uint16_t reg, uint8_t mask, uint8_t value);
+
+/**
+ * Write all dirty registers to the device.
+ *
+ * Consecutive dirty registers are written as one burst and all
+ * bursts are sent in one transfer joined with repeated START.
+ *
+ * @param map The register map.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_reg_flush(esp_i2c_regmap *map);
+
+#endif //ESP_I2C_REG_H
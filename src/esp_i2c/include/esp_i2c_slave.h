@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_I2C_SLAVE_H
+#define ESP_I2C_SLAVE_H
+
+#include <esp_i2c.h>
+
+// Espressif SDK missing includes.
+void ets_isr_attach(int intr, void *handler, void *arg);
+
+// Slave events passed to the callback.
+typedef enum {
+  ESP_I2C_SLAVE_EV_READ,    // Master starts reading from the register window.
+  ESP_I2C_SLAVE_EV_WRITE    // Master wrote bytes to the register window.
+} esp_i2c_slave_ev;
+
+// Slave protocol states.
+typedef enum {
+  ESP_I2C_SLAVE_IDLE,       // Waiting for START.
+  ESP_I2C_SLAVE_ADDR,       // Receiving address byte.
+  ESP_I2C_SLAVE_RX,         // Receiving data byte.
+  ESP_I2C_SLAVE_ACK_OUT,    // Driving ACK for received byte.
+  ESP_I2C_SLAVE_TX,         // Sending data byte.
+  ESP_I2C_SLAVE_ACK_IN,     // Waiting for master ACK / NACK.
+  ESP_I2C_SLAVE_TX_NEXT,    // Master ACKed, next byte goes out.
+  ESP_I2C_SLAVE_STRETCH,    // Holding SCL low till esp_i2c_slave_ready.
+  ESP_I2C_SLAVE_IGNORE      // Not addressed or NACKed, waiting for STOP.
+} esp_i2c_slave_state;
+
+typedef struct esp_i2c_slave esp_i2c_slave;
+
+/**
+ * Slave event callback.
+ *
+ * Called from the GPIO interrupt handler so it must be short and
+ * placed in IRAM. For ESP_I2C_SLAVE_EV_READ the SCL line is held low
+ * (clock stretching) while the callback fills the register window.
+ * Returning false keeps stretching the clock till esp_i2c_slave_ready
+ * is called.
+ *
+ * @param slave The I2C slave.
+ * @param ev    The event.
+ * @param reg   The register the transfer started at.
+ * @param len   The number of bytes written (ESP_I2C_SLAVE_EV_WRITE only).
+ *
+ * @return True if data is ready.
+ */
+typedef bool (*esp_i2c_slave_cb)(esp_i2c_slave *slave, esp_i2c_slave_ev ev, uint8_t reg, uint16_t len);
+
+// I2C slave with register window.
+//
+// The first byte written by the master after the address sets the
+// register pointer. Following bytes are stored in the window starting
+// at the pointer. Reads return bytes from the window starting at the
+// pointer. The pointer wraps around at the window size.
+struct esp_i2c_slave {
+  uint8_t gpio_scl;         // The SCL GPIO number.
+  uint8_t gpio_sda;         // The SDA GPIO number.
+  uint32_t scl_mask;        // The SCL GPIO register mask.
+  uint32_t sda_mask;        // The SDA GPIO register mask.
+  uint8_t address;          // The 7 bit slave address.
+  uint8_t *regs;            // The register window.
+  uint16_t regs_len;        // The register window size.
+  esp_i2c_slave_cb cb;      // The event callback.
+  void *custom;             // Custom data.
+
+  // Set by the slave.
+  esp_i2c_slave_state state; // The protocol state.
+  uint32_t last_in;         // The GPIO_IN at last interrupt.
+  uint8_t byte;             // The byte being shifted.
+  uint8_t bits;             // The number of bits shifted.
+  bool reading;             // Set when master reads from the slave.
+  bool reg_set;             // Set when register pointer was written.
+  uint8_t reg_start;        // The register the transfer started at.
+  uint8_t reg;              // The current register pointer.
+  uint16_t written;         // The number of bytes written by master.
+  uint32_t stretch_start;   // CCOUNT when the clock stretch started.
+  uint32_t first_byte_cycles; // CPU cycles SCL was held before the first data byte.
+};
+
+/**
+ * Initialize I2C slave and enable GPIO interrupts.
+ *
+ * The slave installs the GPIO interrupt handler, so it cannot be used
+ * together with other code attaching GPIO interrupts.
+ *
+ * @param slave    The I2C slave.
+ * @param scl_gpio The SCL GPIO number.
+ * @param sda_gpio The SDA GPIO number.
+ * @param address  The 7 bit slave address.
+ * @param regs     The register window.
+ * @param regs_len The register window size (1 - 256).
+ * @param cb       The event callback. May be NULL.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_slave_init(esp_i2c_slave *slave,
+                   uint8_t scl_gpio,
+                   uint8_t sda_gpio,
+                   uint8_t address,
+                   uint8_t *regs,
+                   uint16_t regs_len,
+                   esp_i2c_slave_cb cb);
+
+/**
+ * Finish clock stretching started by the callback returning false.
+ *
+ * Sends the first bit of the response and releases SCL.
+ *
+ * @param slave The I2C slave.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_slave_ready(esp_i2c_slave *slave);
+
+/**
+ * Disable slave interrupts and release the bus.
+ *
+ * @param slave The I2C slave.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_slave_stop(esp_i2c_slave *slave);
+
+#endif //ESP_I2C_SLAVE_H
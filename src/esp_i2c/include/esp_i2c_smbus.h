@@ -0,0 +1,185 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_I2C_SMBUS_H
+#define ESP_I2C_SMBUS_H
+
+#include <esp_i2c.h>
+
+// SMBus Alert Response Address.
+#define ESP_I2C_SMBUS_ARA 0x0C
+
+// SMBus device.
+//
+// When packet error checking is enabled the PEC (CRC-8, polynomial
+// x^8 + x^2 + x + 1) is calculated byte by byte as bytes go over the bus
+// and is sent / checked at the end of each transaction.
+typedef struct {
+  esp_i2c_bus *bus;         // The I2C bus.
+  uint8_t address;          // The 7 bit slave address.
+  bool pec;                 // Packet error checking enabled.
+  uint8_t crc;              // The PEC of current transaction.
+} esp_i2c_smbus;
+
+/**
+ * Initialize SMBus device.
+ *
+ * @param sm      The SMBus device.
+ * @param bus     The I2C bus.
+ * @param address The 7 bit slave address.
+ * @param pec     Enable packet error checking.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_smbus_init(esp_i2c_smbus *sm, esp_i2c_bus *bus, uint8_t address, bool pec);
+
+/**
+ * Calculate the SMBus PEC of the byte value.
+ *
+ * @param pec   The previously calculated PEC (0 if used first time).
+ * @param value The value to calculate PEC for.
+ *
+ * @return The calculated PEC.
+ */
+uint8_t ICACHE_FLASH_ATTR
+esp_i2c_smbus_pec(uint8_t pec, uint8_t value);
+
+/**
+ * Quick command.
+ *
+ * The read / write bit is the only data sent to the device.
+ *
+ * @param sm   The SMBus device.
+ * @param read The read / write bit value.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_quick(esp_i2c_smbus *sm, bool read);
+
+/**
+ * Send byte without command code.
+ *
+ * @param sm   The SMBus device.
+ * @param data The byte to send.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_send_byte(esp_i2c_smbus *sm, uint8_t data);
+
+/**
+ * Receive byte without command code.
+ *
+ * @param sm   The SMBus device.
+ * @param data The received byte.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_DATA_CORRUPTED on PEC mismatch.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_receive_byte(esp_i2c_smbus *sm, uint8_t *data);
+
+/**
+ * Write byte.
+ *
+ * @param sm   The SMBus device.
+ * @param cmd  The command code.
+ * @param data The byte to write.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_write_byte(esp_i2c_smbus *sm, uint8_t cmd, uint8_t data);
+
+/**
+ * Read byte.
+ *
+ * @param sm   The SMBus device.
+ * @param cmd  The command code.
+ * @param data The read byte.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_DATA_CORRUPTED on PEC mismatch.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_read_byte(esp_i2c_smbus *sm, uint8_t cmd, uint8_t *data);
+
+/**
+ * Write word (low byte first).
+ *
+ * @param sm   The SMBus device.
+ * @param cmd  The command code.
+ * @param data The word to write.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_write_word(esp_i2c_smbus *sm, uint8_t cmd, uint16_t data);
+
+/**
+ * Read word (low byte first).
+ *
+ * @param sm   The SMBus device.
+ * @param cmd  The command code.
+ * @param data The read word.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_DATA_CORRUPTED on PEC mismatch.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_read_word(esp_i2c_smbus *sm, uint8_t cmd, uint16_t *data);
+
+/**
+ * Block write. The byte count is sent before the data.
+ *
+ * @param sm  The SMBus device.
+ * @param cmd The command code.
+ * @param buf The data to write.
+ * @param len The number of bytes to write.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_block_write(esp_i2c_smbus *sm, uint8_t cmd, uint8_t *buf, uint8_t len);
+
+/**
+ * Block read. The device sends the byte count before the data.
+ *
+ * @param sm  The SMBus device.
+ * @param cmd The command code.
+ * @param buf The buffer to read data to.
+ * @param max The buffer size.
+ * @param len The number of bytes read.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_DATA_CORRUPTED on PEC mismatch
+ *         or when the byte count is bigger than the buffer.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_block_read(esp_i2c_smbus *sm, uint8_t cmd, uint8_t *buf, uint8_t max, uint8_t *len);
+
+/**
+ * Read the address of the device asserting SMBALERT#.
+ *
+ * When more than one device asserts the alert the one with the lowest
+ * address wins the arbitration and releases the alert line.
+ *
+ * @param bus     The I2C bus.
+ * @param address The 7 bit address of the alerting device.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_NO_ACK when no device alerts.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_smbus_alert(esp_i2c_bus *bus, uint8_t *address);
+
+#endif //ESP_I2C_SMBUS_H
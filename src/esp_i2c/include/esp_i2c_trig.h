@@ -0,0 +1,128 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_I2C_TRIG_H
+#define ESP_I2C_TRIG_H
+
+#include <esp_i2c.h>
+
+// General call address.
+#define ESP_I2C_GC_ADDR 0x00
+// General call commands.
+#define ESP_I2C_GC_RESET 0x06     // Reset and write programmable part of slave address.
+#define ESP_I2C_GC_LATCH 0x04     // Write programmable part of slave address.
+
+// Maximum number of devices in trigger group.
+#define ESP_I2C_TRIG_MAX 32
+
+// Trigger write to one device.
+typedef struct {
+  uint8_t address;          // The 7 bit slave address.
+  uint8_t *buf;             // The bytes starting the conversion (usually register and value).
+  uint8_t len;              // The number of bytes.
+} esp_i2c_trig;
+
+// Group of devices triggered together.
+//
+// Broadcast group sends one general call to all devices. Burst group
+// sends trigger writes to its devices in one transaction joined with
+// repeated START so the writes follow each other as close as the bus
+// allows.
+typedef struct {
+  esp_i2c_bus *bus;         // The I2C bus.
+  esp_i2c_trig *trigs;      // The trigger writes (burst group).
+  uint8_t num;              // The number of trigger writes (0 for broadcast group).
+  uint8_t *gc_buf;          // The general call bytes (broadcast group).
+  uint8_t gc_len;           // The number of general call bytes.
+
+  // Set by esp_i2c_trig_fire.
+  uint32_t ccount;          // CCOUNT right after the first device got its trigger.
+  uint32_t skew;            // CPU cycles between the first and the last trigger.
+  uint32_t nacks;           // Bit set for every trigger write not acknowledged.
+} esp_i2c_trig_group;
+
+/**
+ * Send general call.
+ *
+ * @param bus The I2C bus.
+ * @param buf The bytes to send after general call address.
+ * @param len The number of bytes.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_NO_ACK if no device acknowledged.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_general_call(esp_i2c_bus *bus, uint8_t *buf, uint16_t len);
+
+/**
+ * Send general call software reset.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_gc_reset(esp_i2c_bus *bus);
+
+/**
+ * Send general call latch of programmable address part.
+ *
+ * @param bus The I2C bus.
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_bus_gc_latch(esp_i2c_bus *bus);
+
+/**
+ * Initialize broadcast trigger group.
+ *
+ * @param group The trigger group.
+ * @param bus   The I2C bus.
+ * @param buf   The bytes to send after general call address.
+ * @param len   The number of bytes.
+ */
+void ICACHE_FLASH_ATTR
+esp_i2c_trig_init_gc(esp_i2c_trig_group *group, esp_i2c_bus *bus, uint8_t *buf, uint8_t len);
+
+/**
+ * Initialize burst trigger group.
+ *
+ * @param group The trigger group.
+ * @param bus   The I2C bus.
+ * @param trigs The trigger writes.
+ * @param num   The number of trigger writes (up to ESP_I2C_TRIG_MAX).
+ *
+ * @return The I2C error code.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_trig_init(esp_i2c_trig_group *group, esp_i2c_bus *bus, esp_i2c_trig *trigs, uint8_t num);
+
+/**
+ * Trigger all devices in the group.
+ *
+ * The timestamp of the trigger moment is taken after ACK of the last
+ * trigger byte. Devices not acknowledging their trigger are marked in
+ * group nacks and do not stop the burst.
+ *
+ * @param group The trigger group.
+ *
+ * @return The I2C error code. ESP_I2C_ERR_NO_ACK if no device was triggered.
+ */
+esp_i2c_err ICACHE_FLASH_ATTR
+esp_i2c_trig_fire(esp_i2c_trig_group *group);
+
+#endif //ESP_I2C_TRIG_H
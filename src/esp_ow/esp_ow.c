@@ -18,12 +18,47 @@
 #include <esp_ow.h>
 #include <esp_gpio.h>
 #include <mem.h>
-
-
-#define OW_LOW(gpio_num) (GPIO_OUT_EN_S = (0x1 << (gpio_num)))
-#define OW_HIGH(gpio_num) (GPIO_OUT_EN_C = (0x1 << (gpio_num)))
-#define OW_RELEASE(gpio_num) (GPIO_OUT_EN_C = (0x1 << (gpio_num)))
-#define OW_READ(gpio_num) ((GPIO_IN & (0x1 << (gpio_num))) != 0)
+#include <user_interface.h>
+#include "esp_ow_priv.h"
+
+// Bit slot and reset timings of one bus speed.
+typedef struct {
+  uint8_t rd_low_q;      // Read slot low time in quarters of microsecond.
+  uint8_t rd_sample_q;   // Read slot release to sample time in quarters of microsecond.
+  uint8_t w1_low_q;      // Write 1 slot low time in quarters of microsecond.
+  uint8_t w0_low_q;      // Write 0 slot low time in quarters of microsecond.
+  uint8_t rd_rec_us;     // Read slot recovery in microseconds.
+  uint8_t w1_rec_us;     // Write 1 slot recovery in microseconds.
+  uint8_t w0_rec_us;     // Write 0 slot recovery in microseconds.
+  uint8_t pd_step_us;    // Presence detect sampling period in microseconds.
+  uint8_t pd_steps;      // Presence detect number of samples.
+  uint16_t rst_low_us;   // Reset pulse in microseconds.
+  uint16_t rst_rec_us;   // Reset release to next slot in microseconds.
+} ow_timing;
+
+// Standard and overdrive speed timings.
+static const ow_timing timings[] = {
+  {8, 20, 20, 220, 53, 55, 5, 5, 14, 480, 480},
+  {4, 4, 4, 30, 7, 8, 3, 1, 10, 70, 48},
+};
+
+// Bit mask of GPIOs in overdrive speed.
+static uint32_t overdrive;
+
+// CPU frequency in MHz.
+static uint8_t cpu_mhz = 80;
+
+// Check if GPIO is in overdrive speed.
+#define OW_IS_OD(gpio_num) (((overdrive >> (gpio_num)) & 0x1) != 0)
+
+// Get timings for the GPIO speed.
+#define OW_TIMING(gpio_num) (&timings[OW_IS_OD(gpio_num)])
+
+// Maximum interrupts off window in microseconds (0 - disabled).
+static uint16_t crit_max_us;
+
+// The OneWire statistics.
+static esp_ow_stats stats;
 
 // The CRC lookup table.
 static uint8_t crc_lookup[] = {
@@ -64,76 +99,215 @@ esp_ow_free_device_list(esp_ow_device *node, bool free_custom)
   }
 }
 
-bool ICACHE_FLASH_ATTR
-esp_ow_read_bit(uint8_t gpio_num)
+bool ESP_OW_BIT_ATTR
+esp_ow_crit_enter(uint16_t window_us)
 {
-  bool bit = 0;
+  if (crit_max_us == 0) return false;
+
+  if (window_us > crit_max_us) {
+    stats.crit_skipped++;
+    return false;
+  }
+
+  ets_intr_lock();
+  stats.crit_slots++;
+
+  return true;
+}
+
+/**
+ * Delay doing nothing.
+ *
+ * Overdrive timings need better than microsecond resolution.
+ *
+ * @param quarters The number of quarters of microsecond to wait.
+ */
+static inline void
+delay_q(uint8_t quarters)
+{
+  uint32_t cycles = (uint32_t) quarters * cpu_mhz / 4;
+  uint32_t start = get_ccount();
+
+  while (get_ccount() - start < cycles);
+}
+
+uint16_t ESP_OW_BIT_ATTR
+esp_ow_read_slot(uint8_t gpio_num, bool *bit)
+{
+  const ow_timing *tm = OW_TIMING(gpio_num);
+  bool crit = esp_ow_crit_enter((uint16_t) ((tm->rd_low_q + tm->rd_sample_q + 3) / 4));
 
   OW_LOW(gpio_num);
-  os_delay_us(2);
+  delay_q(tm->rd_low_q);
   OW_RELEASE(gpio_num);
-  os_delay_us(5);
-  bit = OW_READ(gpio_num);
-  os_delay_us(53);
+  delay_q(tm->rd_sample_q);
+  *bit = OW_READ(gpio_num);
+  if (crit) ets_intr_unlock();
 
-  return bit;
+  return tm->rd_rec_us;
 }
 
-void ICACHE_FLASH_ATTR
-esp_ow_write_bit(uint8_t gpio_num, bool bit)
+uint16_t ESP_OW_BIT_ATTR
+esp_ow_write_slot(uint8_t gpio_num, bool bit)
 {
-  OW_LOW(gpio_num);
+  const ow_timing *tm = OW_TIMING(gpio_num);
+  bool crit;
 
   if (bit) {
-    // Write 1.
-    os_delay_us(5);
-    OW_RELEASE(gpio_num);
-    os_delay_us(55);
-  } else {
-    // Write 0.
-    os_delay_us(55);
+    // Write 1. Longer low would be read as 0.
+    crit = esp_ow_crit_enter((uint16_t) ((tm->w1_low_q + 3) / 4));
+    OW_LOW(gpio_num);
+    delay_q(tm->w1_low_q);
     OW_RELEASE(gpio_num);
-    os_delay_us(5);
+    if (crit) ets_intr_unlock();
+
+    return tm->w1_rec_us;
   }
-}
 
-void ICACHE_FLASH_ATTR
-esp_ow_init(uint8_t gpio_num)
-{
-  esp_gpio_setup(gpio_num, GPIO_MODE_INPUT_PULLUP);
+  // Write 0. Longer low is still 0 at standard speed but
+  // overdrive slot low must not exceed 16us.
+  crit = OW_IS_OD(gpio_num);
+  if (crit) {
+    ets_intr_lock();
+    stats.crit_slots++;
+  }
+  OW_LOW(gpio_num);
+  delay_q(tm->w0_low_q);
+  OW_RELEASE(gpio_num);
+  if (crit) ets_intr_unlock();
+
+  return tm->w0_rec_us;
 }
 
-bool ICACHE_FLASH_ATTR
-esp_ow_reset(uint8_t gpio_num)
+uint16_t ESP_OW_BIT_ATTR
+esp_ow_reset_pulse(uint8_t gpio_num)
 {
-  bool atr = false;
-  int8_t retries = 0;
+  if (!OW_IS_OD(gpio_num)) {
+    // Longer standard reset pulse is still a reset pulse.
+    OW_LOW(gpio_num);
+    return OW_TIMING(gpio_num)->rst_low_us;
+  }
 
-  // Hold bus low for 480us (Reset Pulse).
+  // Overdrive reset pulse longer than 80us switches
+  // devices back to standard speed.
+  ets_intr_lock();
+  stats.crit_slots++;
   OW_LOW(gpio_num);
-  os_delay_us(480);
+  os_delay_us(OW_TIMING(gpio_num)->rst_low_us);
+  OW_RELEASE(gpio_num);
+  ets_intr_unlock();
+
+  return 0;
+}
+
+uint16_t ESP_OW_BIT_ATTR
+esp_ow_presence(uint8_t gpio_num, bool *atr)
+{
+  const ow_timing *tm = OW_TIMING(gpio_num);
+  uint8_t steps;
 
   // Releasing bus high and sampling
-  // for 240us for Answer to Reset (ATR)
+  // for Answer to Reset (ATR)
   // from devices on the line.
   OW_RELEASE(gpio_num);
 
-  do {
-    os_delay_us(5);
-    retries++;
+  *atr = false;
+  for (steps = 1; steps <= tm->pd_steps; steps++) {
+    os_delay_us(tm->pd_step_us);
     // At least one device on the line.
     if (OW_READ(gpio_num) == false) {
-      atr = true;
+      *atr = true;
       break;
     }
-  } while (retries < 48);
+  }
+  if (steps > tm->pd_steps) steps = tm->pd_steps;
 
   // The total time of reset pulse must be minimum 2*480us.
-  os_delay_us((uint16_t) (480 - (retries * 5)));
+  return (uint16_t) (tm->rst_rec_us - steps * tm->pd_step_us);
+}
+
+bool ESP_OW_BIT_ATTR
+esp_ow_read_bit(uint8_t gpio_num)
+{
+  bool bit = 0;
+
+  os_delay_us(esp_ow_read_slot(gpio_num, &bit));
+
+  return bit;
+}
+
+void ESP_OW_BIT_ATTR
+esp_ow_write_bit(uint8_t gpio_num, bool bit)
+{
+  os_delay_us(esp_ow_write_slot(gpio_num, bit));
+}
+
+void ICACHE_FLASH_ATTR
+esp_ow_init(uint8_t gpio_num)
+{
+  cpu_mhz = (uint8_t) system_get_cpu_freq();
+  esp_gpio_setup(gpio_num, GPIO_MODE_INPUT_PULLUP);
+}
+
+void ICACHE_FLASH_ATTR
+esp_ow_set_crit(uint16_t max_us)
+{
+  crit_max_us = max_us;
+  cpu_mhz = (uint8_t) system_get_cpu_freq();
+}
+
+void ICACHE_FLASH_ATTR
+esp_ow_get_stats(esp_ow_stats *dst)
+{
+  os_memcpy(dst, &stats, sizeof(esp_ow_stats));
+}
+
+void ICACHE_FLASH_ATTR
+esp_ow_reset_stats()
+{
+  os_memset(&stats, 0, sizeof(esp_ow_stats));
+}
+
+bool ESP_OW_BIT_ATTR
+esp_ow_reset(uint8_t gpio_num)
+{
+  bool atr;
+
+  os_delay_us(esp_ow_reset_pulse(gpio_num));
+  os_delay_us(esp_ow_presence(gpio_num, &atr));
 
   return atr;
 }
 
+bool ICACHE_FLASH_ATTR
+esp_ow_reset_std(uint8_t gpio_num)
+{
+  overdrive &= ~((uint32_t) 0x1 << gpio_num);
+
+  return esp_ow_reset(gpio_num);
+}
+
+bool ICACHE_FLASH_ATTR
+esp_ow_is_od(uint8_t gpio_num)
+{
+  return (overdrive & ((uint32_t) 0x1 << gpio_num)) != 0;
+}
+
+void ICACHE_FLASH_ATTR
+esp_ow_od_skip_rom(uint8_t gpio_num)
+{
+  esp_ow_write(gpio_num, ESP_OW_CMD_OD_SKIP_ROM);
+  overdrive |= (uint32_t) 0x1 << gpio_num;
+}
+
+void ICACHE_FLASH_ATTR
+esp_ow_od_match_rom(uint8_t gpio_num, uint8_t *rom)
+{
+  esp_ow_write(gpio_num, ESP_OW_CMD_OD_MATCH_ROM);
+  overdrive |= (uint32_t) 0x1 << gpio_num;
+  esp_ow_write_bytes(gpio_num, rom, 8);
+}
+
 void ICACHE_FLASH_ATTR
 esp_ow_match_rom(uint8_t gpio_num, uint8_t *rom)
 {
@@ -147,7 +321,7 @@ esp_ow_match_dev(esp_ow_device *device)
   esp_ow_match_rom(device->gpio_num, device->rom);
 }
 
-uint8_t ICACHE_FLASH_ATTR
+uint8_t ESP_OW_BIT_ATTR
 esp_ow_read(uint8_t gpio_num)
 {
   uint8_t byte = 0;
@@ -170,7 +344,7 @@ esp_ow_read_bytes(uint8_t gpio_num, uint8_t *buf, uint8_t len)
   }
 }
 
-void ICACHE_FLASH_ATTR
+void ESP_OW_BIT_ATTR
 esp_ow_write(uint8_t gpio_num, uint8_t byte)
 {
   uint8_t mask;
@@ -190,28 +364,75 @@ esp_ow_write_bytes(uint8_t gpio_num, uint8_t *buf, uint8_t len)
   }
 }
 
+bool ICACHE_FLASH_ATTR
+esp_ow_search_dir(uint8_t *rom, uint8_t bit_idx, uint8_t last_dis, uint8_t *found_dis, bool bit, bool bit_com)
+{
+  uint8_t byte_idx = (uint8_t) ((bit_idx - 1) >> 3);
+  uint8_t mask = (uint8_t) (1 << ((bit_idx - 1) & 0x07));
+  bool dir;
+
+  if (bit == 0 && bit_com == 0) {
+    // Discrepancy.
+    if (bit_idx < last_dis) {
+      // Discrepancy is before the previous search discrepancy.
+      // We use search direction from the last search.
+      dir = (rom[byte_idx] & mask) != 0;
+    } else {
+      // We have reached the last discrepancy from previous
+      // search or this is the first search and first
+      // discrepancy found. We know that during the first search
+      // last_dis is set to 0 so it will never be equal to bit_idx
+      // which always starts from 1. So for the first search we always pick
+      // 0 direction for all consecutive ones we pick 1.
+      dir = (bit_idx == last_dis);
+    }
+
+    // Record the last found discrepancy during this search only if the path taken is 0.
+    // When we take path 1 we are resolving previous discrepancy so there is no
+    // need to mark this position for next try.
+    if (dir == 0) *found_dis = bit_idx;
+  } else {
+    // No discrepancy we use the bit as the direction.
+    dir = bit;
+  }
+
+  if (dir) {
+    rom[byte_idx] |= mask;
+  } else {
+    rom[byte_idx] &= ~mask;
+  }
+
+  return dir;
+}
+
+// Returned by search when it left the family code subtree.
+#define OW_SCH_LEFT_FAMILY ((esp_ow_err) 0xFF)
+
 /**
  * Find deice on the OneWire bus.
  *
  * Uses binary search algorithm to find devices on the bus.
  * Users should call it again and again till the is_last argument is set to true.
- * Each call updates prev_search with ROM address of newly found device.
+ * Each call updates rom with ROM address of newly found device.
  *
- * When function returns false caller must start search for devices on the bus all over again.
+ * When function returns error caller must start search for devices on the bus all over again.
  *
- * @param sch_type    The search type.
- * @param prev_search The previous device found on the bus. For the first search the address will contain all zeros.
- * @param prev_dis    The discrepancy address position found during the previous search. This function sets
- *                    it to the last discrepancy found during current search.
- * @param is_last     Set by current function call to true if this is the last device on the bus.
+ * @param sch_type   The search type.
+ * @param rom        The previous device ROM address found on the bus. For the first search
+ *                   the address will contain all zeros.
+ * @param prev_dis   The discrepancy address position found during the previous search. This function sets
+ *                   it to the last discrepancy found during current search.
+ * @param family_dis Set to the last discrepancy found within family code.
+ * @param is_last    Set by current function call to true if this is the last device on the bus.
+ * @param family     Stop search with OW_SCH_LEFT_FAMILY as soon as it leaves this
+ *                   family code subtree. Set to -1 to search all families.
  *
  * @return The error code.
  */
 static esp_ow_err ICACHE_FLASH_ATTR
-search(uint8_t gpio_num, esp_ow_cmd sch_type, esp_ow_device *prev_search, uint8_t *prev_dis, bool *is_last)
+search(uint8_t gpio_num, esp_ow_cmd sch_type, uint8_t *rom, uint8_t *prev_dis,
+       uint8_t *family_dis, bool *is_last, int16_t family)
 {
-  // The last ROM address found on the bus.
-  uint8_t *prev_adr = prev_search->rom;
   // Current byte index in ROM address array (0-7).
   uint8_t rom_byte_idx = 0;
   // Current ROM address bit index (1-64).
@@ -231,6 +452,8 @@ search(uint8_t gpio_num, esp_ow_cmd sch_type, esp_ow_device *prev_search, uint8_
   // Number of ones seen on the bus.
   uint8_t one_count = 0;
 
+  *family_dis = 0;
+
   if (esp_ow_reset(gpio_num) == false) {
     return ESP_OW_ERR_NO_DEV;
   }
@@ -246,37 +469,9 @@ search(uint8_t gpio_num, esp_ow_cmd sch_type, esp_ow_device *prev_search, uint8_
       return ESP_OW_ERR_NO_DEV;
     }
 
-    if (bit == 0 && bit_com == 0) {
-      // Discrepancy.
-      if (rom_bit_idx < *prev_dis) {
-        // Discrepancy is before the previous search discrepancy.
-        // We use search direction from the last search.
-        sch_dir = (uint8_t) ((prev_adr[rom_byte_idx] & rom_bit_idx) ? 1 : 0);
-      } else {
-        // We have reached the last discrepancy from previous
-        // search or this is the first search and first
-        // discrepancy found. We know that during the first search
-        // prev_dis is set to 0 so it will never be equal to rom_bit_idx
-        // which always starts from 1. So for the first search we always pick
-        // 0 direction for all consecutive ones we pick 1.
-        sch_dir = (uint8_t) (rom_bit_idx == *prev_dis);
-      }
-
-      // Record the last found discrepancy during this search only if the path taken is 0.
-      // When we take path 1 we are resolving previous discrepancy so there is no
-      // need to mark this position for next try.
-      if (sch_dir == 0) found_dis = rom_bit_idx;
-    } else {
-      // No discrepancy we use the bit as the direction.
-      sch_dir = bit;
-    }
-
-    if (sch_dir) {
-      prev_adr[rom_byte_idx] |= rom_byte_mask;
-      one_count++;
-    } else {
-      prev_adr[rom_byte_idx] &= ~rom_byte_mask;
-    }
+    sch_dir = esp_ow_search_dir(rom, rom_bit_idx, *prev_dis, &found_dis, bit, bit_com);
+    if (sch_dir) one_count++;
+    if (found_dis == rom_bit_idx && rom_bit_idx <= 8) *family_dis = found_dis;
 
     esp_ow_write_bit(gpio_num, sch_dir);
     //os_printf("w: %d %d %d | %d %d\n", rom_bit_idx, rom_byte_idx, sch_dir, bit, bit_com);
@@ -288,9 +483,12 @@ search(uint8_t gpio_num, esp_ow_cmd sch_type, esp_ow_device *prev_search, uint8_
 
     // When rom_byte_mask is 0 it means we finished with current ROM address byte.
     if (rom_byte_mask == 0) {
-      crc = esp_ow_crc8(crc, prev_adr[rom_byte_idx]);
+      crc = esp_ow_crc8(crc, rom[rom_byte_idx]);
       rom_byte_mask = 1;
       rom_byte_idx++;
+
+      // Left the family subtree, devices will wait for the next reset.
+      if (rom_byte_idx == 1 && family >= 0 && rom[0] != family) return OW_SCH_LEFT_FAMILY;
     }
   } while (rom_byte_idx < 8);
 
@@ -327,40 +525,39 @@ esp_ow_new_dev(uint8_t *rom)
   return device;
 }
 
+// Search modes.
+#define OW_SCH_ALL 0         // Find all devices.
+#define OW_SCH_FAMILY 1      // Find devices of one family.
+#define OW_SCH_SKIP_FAMILY 2 // Find devices of all but one family.
+
 /**
- * Create device node based on previous node.
- *
- * The new device address is copied from the previous device.
+ * Find devices on the bus.
  *
- * @param prev_node The previous node.
+ * @param gpio_num    The GPIO connected to OneWire data bus.
+ * @param sch_type    The search type.
+ * @param family_code The family code for OW_SCH_FAMILY and OW_SCH_SKIP_FAMILY modes.
+ * @param mode        The OW_SCH_* search mode.
+ * @param root        The found devices list.
  *
- * @return The new device.
+ * @return The error code.
  */
-static esp_ow_device *ICACHE_FLASH_ATTR
-add_device(esp_ow_device *prev_node)
-{
-  esp_ow_device *new_node = esp_ow_new_dev(prev_node->rom);
-  if (new_node == NULL) return NULL;
-
-  new_node->gpio_num = prev_node->gpio_num;
-  prev_node->next = new_node;
-
-  return new_node;
-}
-
-esp_ow_err ICACHE_FLASH_ATTR
-esp_ow_search(uint8_t gpio_num, esp_ow_cmd sch_type, esp_ow_device **root)
+static esp_ow_err ICACHE_FLASH_ATTR
+search_list(uint8_t gpio_num, esp_ow_cmd sch_type, uint8_t family_code, uint8_t mode, esp_ow_device **root)
 {
+  // The ROM address of the last found device.
+  uint8_t rom[8] = {0};
   // The ROM address bit number where we encountered last discrepancy.
   uint8_t last_disc = 0;
+  // The last discrepancy within family code.
+  uint8_t family_disc = 0;
   // Set to true by search function when last device ROM address is acquired.
   bool is_last_dev = false;
   // Search error code.
   esp_ow_err err;
-  // The current device.
-  esp_ow_device *dev_curr;
-  // Number of found devices on the bus.
-  int8_t found_count = 0;
+  // The last device on the list.
+  esp_ow_device *dev_tail = NULL;
+  // The new device.
+  esp_ow_device *dev;
 
   if (*root != NULL) {
     return ESP_OW_ERR_ROOT_NOT_NULL;
@@ -371,30 +568,46 @@ esp_ow_search(uint8_t gpio_num, esp_ow_cmd sch_type, esp_ow_device **root)
     return ESP_OW_ERR_BAD_CMD;
   }
 
-  // Initialize rom list.
-  dev_curr = *root = os_zalloc(sizeof(esp_ow_device));
-  if (dev_curr == NULL) {
-    return ESP_OW_ERR_MEM;
+  // Start search with the family code path so the first
+  // device found is the first device of the family.
+  if (mode == OW_SCH_FAMILY) {
+    rom[0] = family_code;
+    last_disc = 64;
   }
-  dev_curr->gpio_num = gpio_num;
 
   do {
-    err = search(gpio_num, sch_type, dev_curr, &last_disc, &is_last_dev);
+    err = search(gpio_num, sch_type, rom, &last_disc, &family_disc, &is_last_dev,
+                 (int16_t) (mode == OW_SCH_FAMILY ? family_code : -1));
     //os_printf("SCH: %d\n", err);
+    if (err != ESP_OW_OK) break;
 
-    if (err == ESP_OW_OK && is_last_dev == false) {
-      found_count++;
-      dev_curr = add_device(dev_curr);
-      if (dev_curr == NULL) {
-        err = ESP_OW_ERR_MEM;
-        break;
-      }
+    if (mode == OW_SCH_SKIP_FAMILY && rom[0] == family_code) {
+      // Continue from the last discrepancy before
+      // the family code which skips the whole family.
+      last_disc = family_disc;
+      is_last_dev = (family_disc == 0);
       continue;
     }
 
-    break;
+    dev = esp_ow_new_dev(rom);
+    if (dev == NULL) {
+      err = ESP_OW_ERR_MEM;
+      break;
+    }
+    dev->gpio_num = gpio_num;
+
+    if (dev_tail == NULL) {
+      *root = dev;
+    } else {
+      dev_tail->next = dev;
+    }
+    dev_tail = dev;
   } while (is_last_dev == false);
 
+  // Search left the family after finding all its devices.
+  if (err == OW_SCH_LEFT_FAMILY) err = ESP_OW_OK;
+  if (err == ESP_OW_OK && *root == NULL) err = ESP_OW_ERR_NO_DEV;
+
   if (err != ESP_OW_OK) {
     esp_ow_free_device_list(*root, false);
     *root = NULL;
@@ -404,41 +617,21 @@ esp_ow_search(uint8_t gpio_num, esp_ow_cmd sch_type, esp_ow_device **root)
 }
 
 esp_ow_err ICACHE_FLASH_ATTR
-esp_ow_search_family(uint8_t gpio_num, esp_ow_cmd sch_type, uint8_t family_code, esp_ow_device **root)
+esp_ow_search(uint8_t gpio_num, esp_ow_cmd sch_type, esp_ow_device **root)
 {
-  esp_ow_err err;
-  esp_ow_device *prev = NULL;
-  esp_ow_device *curr = NULL;
-
-  err = esp_ow_search(gpio_num, sch_type, root);
-  if (err != ESP_OW_OK) return err;
-
-  // Filter out devices not matching family code.
-  curr = *root;
-  while (curr != NULL) {
-    if (curr->rom[0] != family_code) {
-      if (prev == NULL) {
-        // Removing head.
-        *root = curr->next;
-        os_free(curr);
-        curr = *root;
-        if (curr == NULL) break; // No more devices.
-      } else {
-        prev->next = curr->next;
-        os_free(curr);
-        curr = prev->next;
-      }
-    } else {
-      prev = curr;
-      curr = curr->next;
-    }
-  }
+  return search_list(gpio_num, sch_type, 0, OW_SCH_ALL, root);
+}
 
-  if (*root == NULL) {
-    return ESP_OW_ERR_NO_DEV;
-  }
+esp_ow_err ICACHE_FLASH_ATTR
+esp_ow_search_family(uint8_t gpio_num, esp_ow_cmd sch_type, uint8_t family_code, esp_ow_device **root)
+{
+  return search_list(gpio_num, sch_type, family_code, OW_SCH_FAMILY, root);
+}
 
-  return ESP_OW_OK;
+esp_ow_err ICACHE_FLASH_ATTR
+esp_ow_search_skip_family(uint8_t gpio_num, esp_ow_cmd sch_type, uint8_t family_code, esp_ow_device **root)
+{
+  return search_list(gpio_num, sch_type, family_code, OW_SCH_SKIP_FAMILY, root);
 }
 
 void ICACHE_FLASH_ATTR
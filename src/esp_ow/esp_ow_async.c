@@ -0,0 +1,410 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_ow_async.h>
+#include <osapi.h>
+#include "esp_ow_priv.h"
+
+// The transaction queues indexed by GPIO number.
+static esp_ow_async *queues[ESP_OW_ASYNC_GPIOS];
+
+// Drive the engine with os_timer.
+static bool use_os_timer = true;
+
+
+/**
+ * Finish transaction with error.
+ *
+ * @param trans The transaction.
+ * @param err   The OneWire error code.
+ *
+ * @return Always 0.
+ */
+static uint32_t ICACHE_FLASH_ATTR
+async_fail(esp_ow_async *trans, esp_ow_err err)
+{
+  OW_RELEASE(trans->gpio_num);
+  trans->err = err;
+  trans->state = ESP_OW_AS_IDLE;
+
+  return 0;
+}
+
+/**
+ * Move transaction to the next state.
+ *
+ * The order is: reset, search or write, read.
+ *
+ * @param trans The transaction.
+ */
+static void ICACHE_FLASH_ATTR
+async_next_state(esp_ow_async *trans)
+{
+  trans->phase = 0;
+  trans->mask = 1;
+  trans->idx = 0;
+
+  if (trans->state == ESP_OW_AS_RESET && trans->search != 0) {
+    trans->state = ESP_OW_AS_SEARCH;
+    trans->bit_idx = 1;
+    trans->found_dis = 0;
+    trans->family_dis = 0;
+    trans->crc = 0;
+    trans->ones = 0;
+    return;
+  }
+
+  if (trans->state < ESP_OW_AS_WRITE && trans->wr_len > 0) {
+    trans->state = ESP_OW_AS_WRITE;
+    return;
+  }
+
+  if (trans->state < ESP_OW_AS_READ && trans->rd_len > 0) {
+    trans->state = ESP_OW_AS_READ;
+    return;
+  }
+
+  trans->state = ESP_OW_AS_IDLE;
+}
+
+/**
+ * Reset pulse and presence detect.
+ *
+ * @param trans The transaction.
+ *
+ * @return The microseconds till the next phase.
+ */
+static uint32_t ESP_OW_BIT_ATTR
+async_reset(esp_ow_async *trans)
+{
+  bool atr;
+  uint16_t wait_us;
+
+  if (trans->phase == 0) {
+    // Overdrive pulse is done in place and returns 0.
+    trans->phase = 1;
+    return esp_ow_reset_pulse(trans->gpio_num);
+  }
+
+  wait_us = esp_ow_presence(trans->gpio_num, &atr);
+  if (!atr) return async_fail(trans, ESP_OW_ERR_NO_DEV);
+
+  async_next_state(trans);
+
+  return wait_us;
+}
+
+/**
+ * Write one bit from write buffer.
+ *
+ * @param trans The transaction.
+ *
+ * @return The microseconds till the next phase.
+ */
+static uint32_t ESP_OW_BIT_ATTR
+async_write(esp_ow_async *trans)
+{
+  uint16_t wait_us;
+
+  wait_us = esp_ow_write_slot(trans->gpio_num, (trans->wr_buf[trans->idx] & trans->mask) != 0);
+
+  trans->mask <<= 1;
+  if (trans->mask == 0) {
+    trans->mask = 1;
+    if (++trans->idx == trans->wr_len) async_next_state(trans);
+  }
+
+  return wait_us;
+}
+
+/**
+ * Read one bit to read buffer.
+ *
+ * @param trans The transaction.
+ *
+ * @return The microseconds till the next phase.
+ */
+static uint32_t ESP_OW_BIT_ATTR
+async_read(esp_ow_async *trans)
+{
+  bool bit;
+  uint16_t wait_us;
+
+  wait_us = esp_ow_read_slot(trans->gpio_num, &bit);
+
+  if (trans->mask == 1) trans->rd_buf[trans->idx] = 0;
+  if (bit) trans->rd_buf[trans->idx] |= trans->mask;
+
+  trans->mask <<= 1;
+  if (trans->mask == 0) {
+    trans->mask = 1;
+    if (++trans->idx == trans->rd_len) async_next_state(trans);
+  }
+
+  return wait_us;
+}
+
+/**
+ * Finish search after all ROM address bits were found.
+ *
+ * @param trans The transaction.
+ */
+static void ICACHE_FLASH_ATTR
+async_search_end(esp_ow_async *trans)
+{
+  trans->state = ESP_OW_AS_IDLE;
+
+  if (trans->crc != 0) {
+    trans->err = ESP_OW_ERR_BAD_CRC;
+    return;
+  }
+
+  // There is no way we haven't received any ones.
+  if (trans->ones == 0) {
+    trans->err = ESP_OW_ERR_PIN_FLAPPING;
+    return;
+  }
+
+  trans->last_dis = trans->found_dis;
+  trans->last = (trans->found_dis == 0);
+}
+
+/**
+ * Search command and ROM address bit triplets.
+ *
+ * Phase 0 writes the search command, phases 1 and 2 read
+ * the bit and its complement, phase 3 writes the direction.
+ *
+ * @param trans The transaction.
+ *
+ * @return The microseconds till the next phase.
+ */
+static uint32_t ESP_OW_BIT_ATTR
+async_search(esp_ow_async *trans)
+{
+  bool bit_com;
+  uint16_t wait_us;
+
+  switch (trans->phase) {
+    case 0:
+      wait_us = esp_ow_write_slot(trans->gpio_num, (trans->search & trans->mask) != 0);
+      trans->mask <<= 1;
+      if (trans->mask == 0) trans->phase = 1;
+      return wait_us;
+
+    case 1:
+      wait_us = esp_ow_read_slot(trans->gpio_num, &trans->bit);
+      trans->phase = 2;
+      return wait_us;
+
+    case 2:
+      wait_us = esp_ow_read_slot(trans->gpio_num, &bit_com);
+
+      // No devices on the bus or error.
+      if (trans->bit == 1 && bit_com == 1) return async_fail(trans, ESP_OW_ERR_NO_DEV);
+
+      trans->bit = esp_ow_search_dir(trans->rom, trans->bit_idx, trans->last_dis,
+                                     &trans->found_dis, trans->bit, bit_com);
+      if (trans->bit) trans->ones++;
+      if (trans->found_dis == trans->bit_idx && trans->bit_idx <= 8) trans->family_dis = trans->found_dis;
+      trans->phase = 3;
+      return wait_us;
+
+    default:
+      wait_us = esp_ow_write_slot(trans->gpio_num, trans->bit);
+
+      // Finished with current ROM address byte.
+      if ((trans->bit_idx & 0x07) == 0) {
+        trans->crc = esp_ow_crc8(trans->crc, trans->rom[(trans->bit_idx - 1) >> 3]);
+      }
+
+      if (trans->bit_idx == 64) {
+        async_search_end(trans);
+      } else {
+        trans->bit_idx++;
+        trans->phase = 1;
+      }
+      return wait_us;
+  }
+}
+
+/**
+ * Run one phase of the transaction.
+ *
+ * @param trans The transaction.
+ *
+ * @return The microseconds till the next phase.
+ */
+static uint32_t ESP_OW_BIT_ATTR
+async_phase(esp_ow_async *trans)
+{
+  switch (trans->state) {
+    case ESP_OW_AS_RESET:
+      return async_reset(trans);
+
+    case ESP_OW_AS_WRITE:
+      return async_write(trans);
+
+    case ESP_OW_AS_READ:
+      return async_read(trans);
+
+    case ESP_OW_AS_SEARCH:
+      return async_search(trans);
+
+    default:
+      trans->state = ESP_OW_AS_IDLE;
+      return 0;
+  }
+}
+
+/**
+ * Prepare transaction for execution.
+ *
+ * @param trans The transaction.
+ */
+static void ICACHE_FLASH_ATTR
+async_begin(esp_ow_async *trans)
+{
+  trans->err = ESP_OW_OK;
+  trans->busy_cycles = 0;
+  trans->total_cycles = get_ccount();
+
+  if (trans->reset || trans->search != 0) {
+    trans->state = ESP_OW_AS_RESET;
+    trans->phase = 0;
+  } else {
+    trans->state = ESP_OW_AS_IDLE;
+    async_next_state(trans);
+  }
+}
+
+static void ICACHE_FLASH_ATTR
+async_timer_cb(void *arg);
+
+/**
+ * Schedule next step of the transaction.
+ *
+ * @param trans The transaction.
+ * @param us    The microseconds till the next step.
+ */
+static void ICACHE_FLASH_ATTR
+async_arm(esp_ow_async *trans, uint32_t us)
+{
+  if (!use_os_timer) return;
+
+  os_timer_disarm(&trans->timer);
+  os_timer_setfn(&trans->timer, async_timer_cb, trans);
+  ets_timer_arm_new(&trans->timer, us, false, false);
+}
+
+/**
+ * Remove finished transaction from the queue and notify the caller.
+ *
+ * @param trans The finished transaction.
+ */
+static void ICACHE_FLASH_ATTR
+async_done(esp_ow_async *trans)
+{
+  queues[trans->gpio_num] = trans->next;
+  trans->next = NULL;
+  trans->total_cycles = get_ccount() - trans->total_cycles;
+
+  if (queues[trans->gpio_num] != NULL) async_begin(queues[trans->gpio_num]);
+
+  if (trans->cb != NULL) trans->cb(trans, trans->err);
+}
+
+static void ICACHE_FLASH_ATTR
+async_timer_cb(void *arg)
+{
+  uint8_t gpio_num = ((esp_ow_async *) arg)->gpio_num;
+  uint32_t us = esp_ow_async_step(gpio_num);
+
+  if (us > 0) async_arm(queues[gpio_num], us);
+}
+
+void ICACHE_FLASH_ATTR
+esp_ow_async_use_timer(bool use_timer)
+{
+  use_os_timer = use_timer;
+}
+
+esp_ow_err ICACHE_FLASH_ATTR
+esp_ow_async_submit(esp_ow_async *trans)
+{
+  esp_ow_async *tail;
+
+  if (trans->gpio_num >= ESP_OW_ASYNC_GPIOS) return ESP_OW_ERR;
+
+  // Make sure only search commands are passed.
+  if (trans->search != 0 &&
+      !(trans->search == ESP_OW_CMD_SEARCH_ROM || trans->search == ESP_OW_CMD_SEARCH_ROM_ALERT)) {
+    return ESP_OW_ERR_BAD_CMD;
+  }
+
+  trans->next = NULL;
+  trans->state = ESP_OW_AS_IDLE;
+
+  tail = queues[trans->gpio_num];
+  if (tail != NULL) {
+    while (tail->next != NULL) tail = tail->next;
+    tail->next = trans;
+    return ESP_OW_OK;
+  }
+
+  queues[trans->gpio_num] = trans;
+  async_begin(trans);
+  async_arm(trans, ESP_OW_ASYNC_MIN_US);
+
+  return ESP_OW_OK;
+}
+
+uint32_t ICACHE_FLASH_ATTR
+esp_ow_async_step(uint8_t gpio_num)
+{
+  uint32_t wait_us;
+  uint32_t start;
+  esp_ow_async *trans = queues[gpio_num];
+
+  if (trans == NULL) return 0;
+
+  start = get_ccount();
+
+  // Run phases till there is enough time to give the CPU back.
+  wait_us = 0;
+  while (trans->state != ESP_OW_AS_IDLE) {
+    wait_us = async_phase(trans);
+    if (wait_us >= ESP_OW_ASYNC_MIN_US) break;
+    os_delay_us((uint16_t) wait_us);
+    wait_us = 0;
+  }
+
+  trans->busy_cycles += get_ccount() - start;
+  if (trans->state != ESP_OW_AS_IDLE) return wait_us;
+
+  async_done(trans);
+  if (queues[gpio_num] == NULL) return 0;
+
+  // Next transaction starts after the last slot recovery.
+  return wait_us > 0 ? wait_us : ESP_OW_ASYNC_MIN_US;
+}
+
+bool ICACHE_FLASH_ATTR
+esp_ow_async_busy(uint8_t gpio_num)
+{
+  return gpio_num < ESP_OW_ASYNC_GPIOS && queues[gpio_num] != NULL;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+// Internal definitions shared by OneWire library sources.
+// Not part of the public API.
+
+#ifndef ESP_OW_PRIV_H
+#define ESP_OW_PRIV_H
+
+#include <esp_ow.h>
+#include <esp_gpio.h>
+
+#define OW_LOW(gpio_num) (GPIO_OUT_EN_S = (0x1 << (gpio_num)))
+#define OW_HIGH(gpio_num) (GPIO_OUT_EN_C = (0x1 << (gpio_num)))
+#define OW_RELEASE(gpio_num) (GPIO_OUT_EN_C = (0x1 << (gpio_num)))
+#define OW_READ(gpio_num) ((GPIO_IN & (0x1 << (gpio_num))) != 0)
+
+// Espressif SDK missing includes.
+void ets_intr_lock();
+void ets_intr_unlock();
+
+/**
+ * Get CPU cycle counter.
+ *
+ * @return The CCOUNT register value.
+ */
+static inline uint32_t
+get_ccount()
+{
+#ifdef ESP_HOST_TEST
+  // Simulated CPU (see test/host.h).
+  return host_ccount();
+#else
+  uint32_t ccount;
+  __asm__ __volatile__("rsr %0, ccount" : "=a" (ccount));
+  return ccount;
+#endif
+}
+
+/**
+ * Disable interrupts for time critical part of bit slot.
+ *
+ * @param window_us The interrupts off window in microseconds.
+ *
+ * @return True if interrupts were disabled.
+ */
+bool ESP_OW_BIT_ATTR
+esp_ow_crit_enter(uint16_t window_us);
+
+/**
+ * Start reset pulse.
+ *
+ * Overdrive reset pulse is done in place with interrupts disabled.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ *
+ * @return The reset pulse time left in microseconds.
+ */
+uint16_t ESP_OW_BIT_ATTR
+esp_ow_reset_pulse(uint8_t gpio_num);
+
+/**
+ * End reset pulse and detect presence pulse.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ * @param atr      Set to true if at least one device answered.
+ *
+ * @return The reset recovery time left in microseconds.
+ */
+uint16_t ESP_OW_BIT_ATTR
+esp_ow_presence(uint8_t gpio_num, bool *atr);
+
+/**
+ * Choose search direction for ROM address bit.
+ *
+ * The direction is recorded in the ROM address.
+ *
+ * @param rom       The ROM address found during the previous search.
+ * @param bit_idx   The ROM address bit index (1-64).
+ * @param last_dis  The last discrepancy from the previous search.
+ * @param found_dis The last discrepancy found during current search.
+ * @param bit       The bit read from the bus.
+ * @param bit_com   The bit complement read from the bus.
+ *
+ * @return The search direction.
+ */
+bool ICACHE_FLASH_ATTR
+esp_ow_search_dir(uint8_t *rom, uint8_t bit_idx, uint8_t last_dis, uint8_t *found_dis, bool bit, bool bit_com);
+
+#endif //ESP_OW_PRIV_H
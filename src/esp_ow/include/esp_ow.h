@@ -20,6 +20,15 @@
 
 #include <c_types.h>
 
+// Section attribute for per bit routines. When library is built
+// with ESP_OW_IRAM they are placed in IRAM so a flash cache miss
+// can not land inside the read sample window.
+#ifdef ESP_OW_IRAM
+  #define ESP_OW_BIT_ATTR
+#else
+  #define ESP_OW_BIT_ATTR ICACHE_FLASH_ATTR
+#endif
+
 // Linked list of devices found on OneWire bus.
 //
 // The device ROM address structure:
@@ -40,7 +49,9 @@ typedef enum {
   ESP_OW_CMD_MATCH_ROM = 0x55,
   ESP_OW_CMD_SEARCH_ROM = 0xF0,
   ESP_OW_CMD_SEARCH_ROM_ALERT = 0xEC,
-  ESP_OW_CMD_SKIP_ROM = 0xCC
+  ESP_OW_CMD_SKIP_ROM = 0xCC,
+  ESP_OW_CMD_OD_SKIP_ROM = 0x3C,
+  ESP_OW_CMD_OD_MATCH_ROM = 0x69
 } esp_ow_cmd;
 
 // Error codes.
@@ -55,10 +66,19 @@ typedef enum {
   ESP_OW_ERR_PIN_FLAPPING,
 } esp_ow_err;
 
+// OneWire statistics.
+typedef struct {
+  uint32_t crit_slots;   // The number of bit slots run with interrupts disabled.
+  uint32_t crit_skipped; // The number of bit slots longer than interrupts off limit.
+} esp_ow_stats;
+
 
 /**
  * Initialize OneWire bus.
  *
+ * Slot timing is measured in CPU cycles so the function (or
+ * esp_ow_set_crit) must be called again after changing CPU frequency.
+ *
  * @param gpio_num The GPIO connected to OneWire data bus.
  */
 void ICACHE_FLASH_ATTR
@@ -90,6 +110,9 @@ esp_ow_new_dev(uint8_t *rom);
 /**
  * Find deices on the OneWire bus matching family code.
  *
+ * The search starts with the family code path and stops as soon as
+ * it leaves it so devices of other families are not walked.
+ *
  * @param gpio_num    The GPIO connected to OneWire data bus.
  * @param sch_type    ESP_OW_CMD_SEARCH_ROM or ESP_OW_CMD_SEARCH_ROM_ALERT.
  * @param family_code The family code.
@@ -101,6 +124,23 @@ esp_ow_new_dev(uint8_t *rom);
 esp_ow_err ICACHE_FLASH_ATTR
 esp_ow_search_family(uint8_t gpio_num, esp_ow_cmd sch_type, uint8_t family_code, esp_ow_device **root);
 
+/**
+ * Find deices on the OneWire bus not matching family code.
+ *
+ * When first device of the family is found the search jumps over
+ * the whole family so its other devices are not walked.
+ *
+ * @param gpio_num    The GPIO connected to OneWire data bus.
+ * @param sch_type    ESP_OW_CMD_SEARCH_ROM or ESP_OW_CMD_SEARCH_ROM_ALERT.
+ * @param family_code The family code to skip.
+ * @param root        The pointer to root of linked list of found devices on the OneWire bus.
+ *                    Must be set initially to NULL by the caller.
+ *
+ * @return The error code.
+ */
+esp_ow_err ICACHE_FLASH_ATTR
+esp_ow_search_skip_family(uint8_t gpio_num, esp_ow_cmd sch_type, uint8_t family_code, esp_ow_device **root);
+
 /**
  * Read ROM.
  *
@@ -136,11 +176,62 @@ esp_ow_free_device_list(esp_ow_device *node, bool free_custom);
 /**
  * Reset OneWire bus.
  *
+ * The reset is done at current bus speed so devices in overdrive
+ * speed stay in overdrive.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ *
  * @return true if at least one slave on the OneWire bus, false otherwise.
  */
-bool ICACHE_FLASH_ATTR
+bool ESP_OW_BIT_ATTR
 esp_ow_reset(uint8_t gpio_num);
 
+/**
+ * Reset OneWire bus at standard speed.
+ *
+ * All devices on the bus and the bus itself go back to standard speed.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ *
+ * @return true if at least one slave on the OneWire bus, false otherwise.
+ */
+bool ICACHE_FLASH_ATTR
+esp_ow_reset_std(uint8_t gpio_num);
+
+/**
+ * Check if bus is in overdrive speed.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ *
+ * @return true for overdrive, false for standard speed.
+ */
+bool ICACHE_FLASH_ATTR
+esp_ow_is_od(uint8_t gpio_num);
+
+/**
+ * Send overdrive skip rom command.
+ *
+ * Must follow esp_ow_reset_std. All overdrive capable devices
+ * and the bus switch to overdrive speed.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ */
+void ICACHE_FLASH_ATTR
+esp_ow_od_skip_rom(uint8_t gpio_num);
+
+/**
+ * Send overdrive match rom command.
+ *
+ * Must follow esp_ow_reset_std. The command is sent at standard
+ * speed and the ROM address at overdrive speed. The bus stays in
+ * overdrive speed till esp_ow_reset_std.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ * @param rom      The 8 byte array least significant octet first.
+ */
+void ICACHE_FLASH_ATTR
+esp_ow_od_match_rom(uint8_t gpio_num, uint8_t *rom);
+
 /**
  * Send rom address to the OneWire bus.
  *
@@ -186,7 +277,7 @@ esp_ow_crc8(uint8_t crc8, uint8_t value);
  *
  * @return The byte send by the slave.
  */
-uint8_t ICACHE_FLASH_ATTR
+uint8_t ESP_OW_BIT_ATTR
 esp_ow_read(uint8_t gpio_num);
 
 /**
@@ -204,7 +295,7 @@ esp_ow_read_bytes(uint8_t gpio_num, uint8_t *buf, uint8_t len);
  *
  * @param gpio_num The GPIO connected to OneWire data bus.
  */
-void ICACHE_FLASH_ATTR
+void ESP_OW_BIT_ATTR
 esp_ow_write(uint8_t gpio_num, uint8_t byte);
 
 /**
@@ -214,7 +305,7 @@ esp_ow_write(uint8_t gpio_num, uint8_t byte);
  *
  * @return 0 or 1
  */
-bool ICACHE_FLASH_ATTR
+bool ESP_OW_BIT_ATTR
 esp_ow_read_bit(uint8_t gpio_num);
 
 /**
@@ -222,9 +313,65 @@ esp_ow_read_bit(uint8_t gpio_num);
  *
  * @param gpio_num The GPIO connected to OneWire data bus.
  */
-void ICACHE_FLASH_ATTR
+void ESP_OW_BIT_ATTR
 esp_ow_write_bit(uint8_t gpio_num, bool bit);
 
+/**
+ * Run time critical part of read slot.
+ *
+ * The caller must wait returned time before the next slot
+ * (esp_ow_read_bit does it with os_delay_us).
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ * @param bit      The bit read from the bus.
+ *
+ * @return The slot recovery time left in microseconds.
+ */
+uint16_t ESP_OW_BIT_ATTR
+esp_ow_read_slot(uint8_t gpio_num, bool *bit);
+
+/**
+ * Run time critical part of write slot.
+ *
+ * The caller must wait returned time before the next slot
+ * (esp_ow_write_bit does it with os_delay_us).
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ * @param bit      The bit to write.
+ *
+ * @return The slot recovery time left in microseconds.
+ */
+uint16_t ESP_OW_BIT_ATTR
+esp_ow_write_slot(uint8_t gpio_num, bool bit);
+
+/**
+ * Run time critical part of bit slots with interrupts disabled.
+ *
+ * Interrupt landing between pulling the bus low and sampling it
+ * (read slot) or releasing it (write 1 slot) corrupts the bit.
+ * Only this part of the slot is run with interrupts disabled.
+ * Slots with window longer than max_us run with interrupts enabled
+ * and are counted as skipped.
+ *
+ * @param max_us The maximum interrupts off window in microseconds. Zero disables.
+ */
+void ICACHE_FLASH_ATTR
+esp_ow_set_crit(uint16_t max_us);
+
+/**
+ * Get OneWire statistics.
+ *
+ * @param stats The statistics to fill.
+ */
+void ICACHE_FLASH_ATTR
+esp_ow_get_stats(esp_ow_stats *stats);
+
+/**
+ * Reset OneWire statistics.
+ */
+void ICACHE_FLASH_ATTR
+esp_ow_reset_stats();
+
 /**
  * Dump found ROMs.
  *
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef ESP_OW_ASYNC_H
+#define ESP_OW_ASYNC_H
+
+#include <esp_ow.h>
+#include <osapi.h>
+
+// Number of GPIOs asynchronous engine can drive (GPIO0 - GPIO15).
+#define ESP_OW_ASYNC_GPIOS 16
+
+// Shorter waits between slot phases are done in place.
+#define ESP_OW_ASYNC_MIN_US 20
+
+typedef struct esp_ow_async esp_ow_async;
+
+// Callback called when asynchronous transaction finishes.
+typedef void (*esp_ow_async_cb)(esp_ow_async *trans, esp_ow_err err);
+
+// Asynchronous transaction states.
+typedef enum {
+  ESP_OW_AS_IDLE,
+  ESP_OW_AS_RESET,
+  ESP_OW_AS_WRITE,
+  ESP_OW_AS_READ,
+  ESP_OW_AS_SEARCH,
+} esp_ow_as_state;
+
+// Asynchronous OneWire transaction.
+//
+// Optionally resets the bus, then writes wr_len bytes from wr_buf
+// and reads rd_len bytes to rd_buf. Either part may be empty.
+//
+// When search is set to ESP_OW_CMD_SEARCH_ROM or ESP_OW_CMD_SEARCH_ROM_ALERT
+// the bus is reset and the next device ROM address is found instead.
+// Start the search with rom and last_dis set to zeros and resubmit
+// the same transaction till last is set. To start in family code
+// subtree set rom[0] to the family code and last_dis to 64. To skip
+// the rest of found device family set last_dis to family_dis.
+//
+// The transaction must stay valid till the callback is called.
+struct esp_ow_async {
+  uint8_t gpio_num;         // The GPIO connected to OneWire data bus.
+  bool reset;               // Reset the bus before writing.
+  uint8_t *wr_buf;          // The bytes to write.
+  uint16_t wr_len;          // The number of bytes to write.
+  uint8_t *rd_buf;          // The buffer to read bytes to.
+  uint16_t rd_len;          // The number of bytes to read.
+  esp_ow_cmd search;        // The search command or 0.
+  uint8_t rom[8];           // The ROM address found by previous search. Set to found device.
+  uint8_t last_dis;         // The last discrepancy from previous search (0 for new search).
+  bool last;                // Set when found device is the last one on the bus.
+  uint8_t family_dis;       // The last discrepancy within family code.
+  esp_ow_async_cb cb;       // The completion callback.
+  void *custom;             // Custom data to associate with the transaction.
+
+  // Fields below are managed by the library.
+  esp_ow_as_state state;    // The current state.
+  uint8_t phase;            // The phase of current state.
+  uint8_t mask;             // The current bit mask.
+  uint16_t idx;             // The buffer index.
+  uint8_t bit_idx;          // The ROM address bit index during search (1-64).
+  uint8_t found_dis;        // The last discrepancy found during current search.
+  uint8_t crc;              // The ROM address CRC8 during search.
+  uint8_t ones;             // The number of ones in ROM address during search.
+  bool bit;                 // The bit read or to write during search.
+  esp_ow_err err;           // The transaction result.
+  uint32_t busy_cycles;     // CPU cycles spent driving the bus.
+  uint32_t total_cycles;    // CPU cycles from start to completion.
+  os_timer_t timer;         // The timer driving transaction.
+  struct esp_ow_async *next; // The next queued transaction.
+};
+
+/**
+ * Use microsecond os_timer to drive asynchronous engine.
+ *
+ * The engine uses os_timer by default so system_timer_reinit()
+ * must be called in user_init. When disabled the caller must call
+ * esp_ow_async_step after the delay it returns from task context.
+ * The engine runs from flash and calls os_timer and user callbacks
+ * so it must not be stepped directly from interrupt handler.
+ * A hardware timer interrupt may post a task (system_os_post)
+ * which steps it.
+ *
+ * @param use_timer Set to false to drive the engine from your own timer.
+ */
+void ICACHE_FLASH_ATTR
+esp_ow_async_use_timer(bool use_timer);
+
+/**
+ * Submit asynchronous transaction.
+ *
+ * Transactions are queued per GPIO and executed in order they were
+ * submitted. Synchronous calls must not be made on the GPIO till
+ * its queue is empty.
+ *
+ * @param trans The transaction.
+ *
+ * @return The OneWire error code.
+ */
+esp_ow_err ICACHE_FLASH_ATTR
+esp_ow_async_submit(esp_ow_async *trans);
+
+/**
+ * Advance asynchronous engine.
+ *
+ * Runs the time critical part of the next bit slot (or reset pulse)
+ * and returns without waiting for the slot to finish. Must be called
+ * from task context, not from interrupt handler.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ *
+ * @return The microseconds till the next step or 0 when queue is empty.
+ */
+uint32_t ICACHE_FLASH_ATTR
+esp_ow_async_step(uint8_t gpio_num);
+
+/**
+ * Check if asynchronous engine has pending transactions.
+ *
+ * @param gpio_num The GPIO connected to OneWire data bus.
+ *
+ * @return true if busy, false otherwise.
+ */
+bool ICACHE_FLASH_ATTR
+esp_ow_async_busy(uint8_t gpio_num);
+
+#endif //ESP_OW_ASYNC_H
@@ -0,0 +1,643 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "host.h"
+#include <esp_gpio.h>
+#include <ets_sys.h>
+#include <gpio.h>
+#include <user_interface.h>
+
+// CPU cycles spent on access to GPIO register.
+#define HOST_IO_CYCLES 2
+// Maximum number of scheduled events.
+#define HOST_EVENTS 8
+// Maximum number of line changes handled after one register write.
+#define HOST_SETTLE_MAX 16
+
+// Register write waiting to be applied to the lines.
+typedef struct {
+  bool active;
+  host_reg reg;
+  volatile uint32_t value;
+} host_pending;
+
+typedef struct {
+  uint64_t when;
+  uint8_t chip;
+  host_event_cb cb;
+  void *arg;
+} host_event;
+
+// Task registered with system_os_task.
+typedef struct {
+  os_task_t task;
+  os_event_t *queue;
+  uint8_t qlen;
+  uint8_t first;            // The index of the oldest posted event.
+  uint8_t len;              // The number of posted events.
+} host_task;
+
+// Simulated time in CPU cycles.
+static uint64_t now;
+// Lines driven low by each chip (GPIO_OUT_EN register).
+static uint32_t out_en[HOST_CHIPS];
+// Lines each chip drove low since reset.
+static uint32_t drove[HOST_CHIPS];
+static host_pending pending[HOST_CHIPS];
+// The chip running the code.
+static uint8_t chip;
+// Lines state devices were last notified about.
+static uint32_t lines;
+static host_dev *devs;
+static os_timer_t *timers;
+static host_event events[HOST_EVENTS];
+static bool in_events;
+static host_task tasks[USER_TASK_PRIO_MAX];
+
+// Interrupts.
+static uint8_t lock_depth[HOST_CHIPS];
+static uint64_t lock_start[HOST_CHIPS];
+static uint32_t crit_max[HOST_CHIPS];
+static void (*isr)(void *arg);
+static void *isr_arg;
+static bool isr_masked;
+static bool in_isr;
+static uint32_t intr_pins;
+static uint32_t status;
+
+static unsigned long random_state;
+
+// Test results.
+static uint32_t checks;
+static uint32_t failed;
+
+
+/**
+ * Compute lines state.
+ *
+ * @return The lines mask. Bit set when line is high.
+ */
+static uint32_t
+compute_lines()
+{
+  uint8_t idx;
+  uint32_t low = 0;
+  host_dev *dev;
+
+  for (idx = 0; idx < HOST_CHIPS; idx++) low |= out_en[idx];
+  for (dev = devs; dev != NULL; dev = dev->next) low |= dev->drive(dev, now);
+
+  return ~low;
+}
+
+static void
+apply_pending();
+
+static void
+notify();
+
+/**
+ * Run slave chip GPIO interrupt handler while there are pending interrupts.
+ */
+static void
+dispatch_isr()
+{
+  uint8_t saved;
+  uint8_t runs = 0;
+
+  while (isr != NULL && !isr_masked && !in_isr && lock_depth[HOST_CHIP_SLAVE] == 0 && (status & intr_pins)) {
+    // Handler which does not clear the status would run forever.
+    if (++runs > HOST_SETTLE_MAX) break;
+
+    saved = chip;
+    chip = HOST_CHIP_SLAVE;
+    in_isr = true;
+    isr(isr_arg);
+    in_isr = false;
+    chip = saved;
+
+    apply_pending();
+    notify();
+  }
+}
+
+/**
+ * Notify devices about line changes till lines are stable.
+ */
+static void
+notify()
+{
+  uint8_t runs = 0;
+  uint32_t before;
+  uint32_t after;
+  host_dev *dev;
+
+  after = compute_lines();
+  while (after != lines && runs++ < HOST_SETTLE_MAX) {
+    before = lines;
+    lines = after;
+    status |= (before ^ after) & intr_pins;
+    for (dev = devs; dev != NULL; dev = dev->next) {
+      if (dev->edge != NULL) dev->edge(dev, before, after, now);
+    }
+    after = compute_lines();
+  }
+}
+
+/**
+ * Notify devices about line changes and run interrupt handler.
+ */
+static void
+settle()
+{
+  notify();
+  dispatch_isr();
+}
+
+/**
+ * Apply register writes waiting for the next access to the lines.
+ */
+static void
+apply_pending()
+{
+  uint8_t idx;
+  uint32_t value;
+
+  for (idx = 0; idx < HOST_CHIPS; idx++) {
+    if (!pending[idx].active) continue;
+
+    pending[idx].active = false;
+    value = pending[idx].value;
+    if (pending[idx].reg == HOST_REG_OUT_EN_S) {
+      out_en[idx] |= value;
+      drove[idx] |= value;
+    } else {
+      out_en[idx] &= ~value;
+    }
+  }
+}
+
+/**
+ * Apply register writes and propagate line changes.
+ */
+static void
+flush()
+{
+  apply_pending();
+  settle();
+}
+
+/**
+ * Run scheduled events which are due.
+ */
+static void
+run_events()
+{
+  uint8_t idx;
+  uint8_t saved;
+  host_event ev;
+
+  if (in_events) return;
+  in_events = true;
+
+  for (idx = 0; idx < HOST_EVENTS; idx++) {
+    if (events[idx].cb == NULL || events[idx].when > now) continue;
+
+    ev = events[idx];
+    events[idx].cb = NULL;
+
+    saved = chip;
+    chip = ev.chip;
+    ev.cb(ev.arg);
+    flush();
+    chip = saved;
+  }
+
+  in_events = false;
+}
+
+/**
+ * Advance simulated time.
+ *
+ * @param cycles The number of CPU cycles.
+ */
+static void
+advance(uint64_t cycles)
+{
+  flush();
+  now += cycles;
+  settle();
+  run_events();
+}
+
+/**
+ * Remove timer from armed timers.
+ *
+ * @param ptimer The timer.
+ */
+static void
+timer_remove(os_timer_t *ptimer)
+{
+  os_timer_t **tmr;
+
+  for (tmr = &timers; *tmr != NULL; tmr = &(*tmr)->timer_next) {
+    if (*tmr == ptimer) {
+      *tmr = ptimer->timer_next;
+      break;
+    }
+  }
+  ptimer->timer_next = NULL;
+}
+
+void
+host_reset()
+{
+  now = 0;
+  os_memset(out_en, 0, sizeof(out_en));
+  os_memset(drove, 0, sizeof(drove));
+  os_memset(pending, 0, sizeof(pending));
+  chip = HOST_CHIP_MASTER;
+  lines = 0xFFFFFFFF;
+  devs = NULL;
+  timers = NULL;
+  os_memset(events, 0, sizeof(events));
+  in_events = false;
+  os_memset(tasks, 0, sizeof(tasks));
+
+  os_memset(lock_depth, 0, sizeof(lock_depth));
+  os_memset(crit_max, 0, sizeof(crit_max));
+  isr = NULL;
+  isr_arg = NULL;
+  isr_masked = false;
+  in_isr = false;
+  intr_pins = 0;
+  status = 0;
+
+  random_state = 1;
+}
+
+void
+host_attach(host_dev *dev)
+{
+  flush();
+  dev->next = devs;
+  devs = dev;
+  settle();
+}
+
+uint64_t
+host_now()
+{
+  flush();
+  return now;
+}
+
+uint32_t
+host_lines()
+{
+  flush();
+  return lines;
+}
+
+void
+host_idle(uint64_t cycles)
+{
+  advance(cycles);
+}
+
+bool
+host_run_timers(uint64_t limit)
+{
+  os_timer_t *tmr;
+  os_timer_t *next;
+
+  flush();
+
+  while (timers != NULL) {
+    next = timers;
+    for (tmr = timers; tmr != NULL; tmr = tmr->timer_next) {
+      if (tmr->expire < next->expire) next = tmr;
+    }
+
+    if (next->expire > limit) {
+      if (now < limit) advance(limit - now);
+      return false;
+    }
+    if (next->expire > now) advance(next->expire - now);
+
+    timer_remove(next);
+    if (next->period > 0) {
+      next->expire += next->period;
+      next->timer_next = timers;
+      timers = next;
+    }
+
+    chip = HOST_CHIP_MASTER;
+    next->timer_func(next->timer_arg);
+    flush();
+    host_run_tasks();
+  }
+
+  return true;
+}
+
+void
+host_run_tasks()
+{
+  int8_t prio;
+  host_task *tsk;
+  os_event_t event;
+
+  flush();
+
+  for (prio = USER_TASK_PRIO_MAX - 1; prio >= 0; prio--) {
+    tsk = &tasks[prio];
+    if (tsk->len == 0) continue;
+
+    event = tsk->queue[tsk->first];
+    tsk->first = (uint8_t) ((tsk->first + 1) % tsk->qlen);
+    tsk->len--;
+
+    chip = HOST_CHIP_MASTER;
+    tsk->task(&event);
+    flush();
+
+    // Start again from the highest priority.
+    prio = USER_TASK_PRIO_MAX;
+  }
+}
+
+void
+host_at(uint64_t when, uint8_t at_chip, host_event_cb cb, void *arg)
+{
+  uint8_t idx;
+
+  for (idx = 0; idx < HOST_EVENTS; idx++) {
+    if (events[idx].cb != NULL) continue;
+
+    events[idx].when = when;
+    events[idx].chip = at_chip;
+    events[idx].cb = cb;
+    events[idx].arg = arg;
+    return;
+  }
+
+  host_check(false, "host_at: too many events", __FILE__, __LINE__);
+}
+
+void
+host_set_chip(uint8_t new_chip)
+{
+  flush();
+  chip = new_chip;
+}
+
+uint32_t
+host_drove(uint8_t of_chip)
+{
+  flush();
+  return drove[of_chip];
+}
+
+uint32_t
+host_crit_max(uint8_t of_chip)
+{
+  return crit_max[of_chip];
+}
+
+void
+host_check(bool ok, const char *expr, const char *file, int line)
+{
+  checks++;
+  if (ok) return;
+
+  failed++;
+  printf("%s:%d: check failed: %s\n", file, line, expr);
+}
+
+int
+host_result()
+{
+  printf("%u checks, %u failed\n", checks, failed);
+
+  return failed == 0 ? 0 : 1;
+}
+
+// Simulated CPU.
+
+uint32_t
+host_ccount()
+{
+  advance(1);
+
+  return (uint32_t) now;
+}
+
+volatile uint32_t *
+host_gpio_write(host_reg reg)
+{
+  advance(HOST_IO_CYCLES);
+
+  pending[chip].active = true;
+  pending[chip].reg = reg;
+  pending[chip].value = 0;
+
+  return &pending[chip].value;
+}
+
+uint32_t
+host_gpio_in()
+{
+  advance(HOST_IO_CYCLES);
+
+  return lines;
+}
+
+uint32_t
+host_gpio_reg_read(uint32_t reg)
+{
+  advance(HOST_IO_CYCLES);
+
+  return reg == GPIO_STATUS_ADDRESS ? status : 0;
+}
+
+void
+host_gpio_reg_write(uint32_t reg, uint32_t val)
+{
+  advance(HOST_IO_CYCLES);
+
+  if (reg == GPIO_STATUS_W1TC_ADDRESS) status &= ~val;
+}
+
+// Espressif SDK.
+
+void
+esp_gpio_setup(uint8_t gpio_num, esp_gpio_mode mode)
+{
+  // Lines have pull up resistors.
+  (void) gpio_num;
+  (void) mode;
+}
+
+void
+gpio_pin_intr_state_set(uint32_t i, GPIO_INT_TYPE intr_state)
+{
+  if (intr_state == GPIO_PIN_INTR_DISABLE) {
+    intr_pins &= ~((uint32_t) 0x1 << i);
+  } else {
+    intr_pins |= (uint32_t) 0x1 << i;
+  }
+}
+
+void
+ets_isr_attach(int intr, void *handler, void *arg)
+{
+  (void) intr;
+  isr = (void (*)(void *)) handler;
+  isr_arg = arg;
+}
+
+void
+ets_isr_mask(unsigned intr)
+{
+  (void) intr;
+  flush();
+  isr_masked = true;
+}
+
+void
+ets_isr_unmask(unsigned intr)
+{
+  (void) intr;
+  flush();
+  isr_masked = false;
+  dispatch_isr();
+}
+
+void
+ets_intr_lock()
+{
+  flush();
+  if (lock_depth[chip]++ == 0) lock_start[chip] = now;
+}
+
+void
+ets_intr_unlock()
+{
+  uint64_t locked;
+
+  flush();
+  if (lock_depth[chip] == 0 || --lock_depth[chip] > 0) return;
+
+  locked = now - lock_start[chip];
+  if (locked > crit_max[chip]) crit_max[chip] = (uint32_t) locked;
+  dispatch_isr();
+}
+
+void
+os_timer_setfn(os_timer_t *ptimer, os_timer_func_t *pfunction, void *parg)
+{
+  ptimer->timer_func = pfunction;
+  ptimer->timer_arg = parg;
+}
+
+void
+ets_timer_arm_new(os_timer_t *ptimer, uint32_t time, bool repeat_flag, bool ms_flag)
+{
+  uint64_t cycles = HOST_US(ms_flag ? (uint64_t) time * 1000 : time);
+
+  flush();
+  timer_remove(ptimer);
+
+  ptimer->expire = now + cycles;
+  ptimer->period = repeat_flag ? cycles : 0;
+  ptimer->timer_next = timers;
+  timers = ptimer;
+}
+
+void
+os_timer_arm(os_timer_t *ptimer, uint32_t msec, bool repeat_flag)
+{
+  ets_timer_arm_new(ptimer, msec, repeat_flag, true);
+}
+
+void
+os_timer_disarm(os_timer_t *ptimer)
+{
+  timer_remove(ptimer);
+}
+
+void
+os_delay_us(uint16_t us)
+{
+  advance(HOST_US(us));
+}
+
+unsigned long
+os_random()
+{
+  random_state = random_state * 1103515245 + 12345;
+
+  return (random_state >> 16) & 0x7FFF;
+}
+
+uint8_t
+system_get_cpu_freq()
+{
+  return HOST_CPU_MHZ;
+}
+
+uint32_t
+system_get_time()
+{
+  advance(1);
+
+  return (uint32_t) (now / HOST_CPU_MHZ);
+}
+
+bool
+system_os_task(os_task_t task, uint8_t prio, os_event_t *queue, uint8_t qlen)
+{
+  if (prio >= USER_TASK_PRIO_MAX || qlen == 0) return false;
+
+  tasks[prio].task = task;
+  tasks[prio].queue = queue;
+  tasks[prio].qlen = qlen;
+  tasks[prio].first = 0;
+  tasks[prio].len = 0;
+
+  return true;
+}
+
+bool
+system_os_post(uint8_t prio, os_signal_t sig, os_param_t par)
+{
+  host_task *tsk;
+  os_event_t *event;
+
+  if (prio >= USER_TASK_PRIO_MAX || tasks[prio].task == NULL) return false;
+
+  tsk = &tasks[prio];
+  if (tsk->len == tsk->qlen) return false;
+
+  event = &tsk->queue[(tsk->first + tsk->len) % tsk->qlen];
+  event->sig = sig;
+  event->par = par;
+  tsk->len++;
+
+  return true;
+}
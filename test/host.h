@@ -0,0 +1,183 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host simulation of ESP8266 used by library tests.
+//
+// Simulates CPU cycle counter, open drain GPIO lines with pull ups,
+// os_timer, tasks and GPIO interrupts. Up to two chips share the lines:
+// the master chip runs the test and the slave chip runs GPIO
+// interrupt handler. Simulated devices attached to the bus drive
+// lines low and are notified about every line change.
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <c_types.h>
+#include <osapi.h>
+
+// Simulated CPU frequency in MHz.
+#define HOST_CPU_MHZ 80
+
+// Convert microseconds to CPU cycles.
+#define HOST_US(us) ((uint64_t) (us) * HOST_CPU_MHZ)
+
+// Simulated chips.
+#define HOST_CHIP_MASTER 0
+#define HOST_CHIP_SLAVE 1
+#define HOST_CHIPS 2
+
+// Check test condition.
+#define CHECK(cond) host_check((cond), #cond, __FILE__, __LINE__)
+
+typedef struct host_dev host_dev;
+
+// Simulated device attached to the lines.
+struct host_dev {
+  // Return the lines the device drives low at the time.
+  uint32_t (*drive)(host_dev *dev, uint64_t now);
+  // Called after lines changed.
+  void (*edge)(host_dev *dev, uint32_t before, uint32_t after, uint64_t now);
+  host_dev *next;
+};
+
+// Callback for the scheduled event.
+typedef void (*host_event_cb)(void *arg);
+
+/**
+ * Reset simulation.
+ *
+ * Time starts at zero, all lines are released and
+ * all devices, timers and interrupt handlers are removed.
+ */
+void
+host_reset();
+
+/**
+ * Attach device to the lines.
+ *
+ * @param dev The device.
+ */
+void
+host_attach(host_dev *dev);
+
+/**
+ * Get simulated time.
+ *
+ * @return The time in CPU cycles.
+ */
+uint64_t
+host_now();
+
+/**
+ * Get lines state.
+ *
+ * @return The lines mask. Bit set when line is high.
+ */
+uint32_t
+host_lines();
+
+/**
+ * Let the time pass without running any code.
+ *
+ * Timers are not fired. Scheduled events are.
+ *
+ * @param cycles The number of CPU cycles.
+ */
+void
+host_idle(uint64_t cycles);
+
+/**
+ * Fire armed timers till there are none left.
+ *
+ * Time between timers passes idle. Posted tasks run after every timer.
+ *
+ * @param limit The simulated time limit in CPU cycles.
+ *
+ * @return false when limit was reached with timers still armed.
+ */
+bool
+host_run_timers(uint64_t limit);
+
+/**
+ * Run posted tasks till there are none left.
+ *
+ * Higher priority tasks run first. Interrupt handlers run the
+ * tasks they post after they return so tests call it after the
+ * time passed.
+ */
+void
+host_run_tasks();
+
+/**
+ * Schedule event.
+ *
+ * @param when The simulated time in CPU cycles.
+ * @param chip The chip the event runs on.
+ * @param cb   The callback.
+ * @param arg  The callback argument.
+ */
+void
+host_at(uint64_t when, uint8_t chip, host_event_cb cb, void *arg);
+
+/**
+ * Select the chip running the code.
+ *
+ * @param chip The chip.
+ */
+void
+host_set_chip(uint8_t chip);
+
+/**
+ * Get the lines the chip drove low since reset.
+ *
+ * @param chip The chip.
+ *
+ * @return The lines mask.
+ */
+uint32_t
+host_drove(uint8_t chip);
+
+/**
+ * Get the longest time the chip had interrupts disabled.
+ *
+ * @param chip The chip.
+ *
+ * @return The time in CPU cycles.
+ */
+uint32_t
+host_crit_max(uint8_t chip);
+
+/**
+ * Record test condition.
+ *
+ * @param ok   The condition.
+ * @param expr The condition source.
+ * @param file The file name.
+ * @param line The line number.
+ */
+void
+host_check(bool ok, const char *expr, const char *file, int line);
+
+/**
+ * Print summary of checks.
+ *
+ * @return The process exit code.
+ */
+int
+host_result();
+
+#endif //HOST_H
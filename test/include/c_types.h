@@ -0,0 +1,47 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host replacement of Espressif SDK c_types.h.
+
+#ifndef C_TYPES_H
+#define C_TYPES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int32_t sint32;
+
+// Code and data placement has no meaning on the host.
+#define ICACHE_FLASH_ATTR
+#define ICACHE_RAM_ATTR
+#define ICACHE_RODATA_ATTR
+
+#define BIT(nr) (1UL << (nr))
+
+/**
+ * Simulated CCOUNT register. Used by get_ccount when built with ESP_HOST_TEST.
+ *
+ * @return The CPU cycle counter.
+ */
+uint32_t
+host_ccount();
+
+#endif //C_TYPES_H
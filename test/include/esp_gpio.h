@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host replacement of esp_gpio library header.
+//
+// GPIO registers are backed by the simulated bus. Every register
+// write is applied to the bus on the next access to the simulation.
+
+#ifndef ESP_GPIO_H
+#define ESP_GPIO_H
+
+#include <c_types.h>
+#include <osapi.h>
+
+#define GPIO0 0
+#define GPIO1 1
+#define GPIO2 2
+#define GPIO3 3
+#define GPIO4 4
+#define GPIO5 5
+#define GPIO12 12
+#define GPIO13 13
+#define GPIO14 14
+#define GPIO15 15
+#define GPIO16 16
+
+// Simulated GPIO registers.
+typedef enum {
+  HOST_REG_OUT_EN_S,
+  HOST_REG_OUT_EN_C,
+} host_reg;
+
+#define GPIO_OUT_EN_S (*host_gpio_write(HOST_REG_OUT_EN_S))
+#define GPIO_OUT_EN_C (*host_gpio_write(HOST_REG_OUT_EN_C))
+#define GPIO_IN (host_gpio_in())
+
+typedef enum {
+  GPIO_MODE_INPUT,
+  GPIO_MODE_INPUT_PULLUP,
+  GPIO_MODE_OUTPUT,
+} esp_gpio_mode;
+
+void
+esp_gpio_setup(uint8_t gpio_num, esp_gpio_mode mode);
+
+/**
+ * Get simulated register for write.
+ *
+ * @param reg The register.
+ *
+ * @return The pointer the register value must be written to.
+ */
+volatile uint32_t *
+host_gpio_write(host_reg reg);
+
+/**
+ * Read simulated GPIO_IN register.
+ *
+ * @return The lines state.
+ */
+uint32_t
+host_gpio_in();
+
+#endif //ESP_GPIO_H
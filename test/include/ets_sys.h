@@ -0,0 +1,40 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host replacement of Espressif SDK ets_sys.h.
+
+#ifndef ETS_SYS_H
+#define ETS_SYS_H
+
+#include <c_types.h>
+
+#define ETS_GPIO_INUM 4
+
+#define ETS_GPIO_INTR_ATTACH(func, arg) ets_isr_attach(ETS_GPIO_INUM, (func), (void *) (arg))
+#define ETS_GPIO_INTR_DISABLE() ets_isr_mask(1 << ETS_GPIO_INUM)
+#define ETS_GPIO_INTR_ENABLE() ets_isr_unmask(1 << ETS_GPIO_INUM)
+
+void
+ets_isr_attach(int intr, void *handler, void *arg);
+
+void
+ets_isr_mask(unsigned intr);
+
+void
+ets_isr_unmask(unsigned intr);
+
+#endif //ETS_SYS_H
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host replacement of Espressif SDK gpio.h.
+
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <c_types.h>
+
+#define GPIO_STATUS_ADDRESS 0x1c
+#define GPIO_STATUS_W1TC_ADDRESS 0x24
+
+#define GPIO_ID_PIN(n) (n)
+
+#define GPIO_REG_READ(reg) host_gpio_reg_read(reg)
+#define GPIO_REG_WRITE(reg, val) host_gpio_reg_write((reg), (val))
+
+typedef enum {
+  GPIO_PIN_INTR_DISABLE = 0,
+  GPIO_PIN_INTR_POSEDGE = 1,
+  GPIO_PIN_INTR_NEGEDGE = 2,
+  GPIO_PIN_INTR_ANYEDGE = 3,
+  GPIO_PIN_INTR_LOLEVEL = 4,
+  GPIO_PIN_INTR_HILEVEL = 5
+} GPIO_INT_TYPE;
+
+void
+gpio_pin_intr_state_set(uint32_t i, GPIO_INT_TYPE intr_state);
+
+uint32_t
+host_gpio_reg_read(uint32_t reg);
+
+void
+host_gpio_reg_write(uint32_t reg, uint32_t val);
+
+#endif //GPIO_H
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host replacement of Espressif SDK osapi.h.
+
+#ifndef OSAPI_H
+#define OSAPI_H
+
+#include <c_types.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef void os_timer_func_t(void *timer_arg);
+
+typedef struct _os_timer_t {
+  struct _os_timer_t *timer_next;
+  uint64_t expire;          // The simulated time the timer fires at in CPU cycles.
+  uint64_t period;          // The period in CPU cycles or 0 for one shot timer.
+  os_timer_func_t *timer_func;
+  void *timer_arg;
+} os_timer_t;
+
+#define os_memcmp memcmp
+#define os_memcpy memcpy
+#define os_memset memset
+#define os_printf printf
+
+void
+os_timer_setfn(os_timer_t *ptimer, os_timer_func_t *pfunction, void *parg);
+
+void
+os_timer_arm(os_timer_t *ptimer, uint32_t msec, bool repeat_flag);
+
+void
+ets_timer_arm_new(os_timer_t *ptimer, uint32_t time, bool repeat_flag, bool ms_flag);
+
+void
+os_timer_disarm(os_timer_t *ptimer);
+
+void
+os_delay_us(uint16_t us);
+
+unsigned long
+os_random();
+
+#endif //OSAPI_H
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Host replacement of Espressif SDK user_interface.h.
+
+#ifndef USER_INTERFACE_H
+#define USER_INTERFACE_H
+
+#include <osapi.h>
+
+#define USER_TASK_PRIO_0 0
+#define USER_TASK_PRIO_1 1
+#define USER_TASK_PRIO_2 2
+#define USER_TASK_PRIO_MAX 3
+
+typedef uint32_t os_signal_t;
+// Wide enough to pass a pointer on the host.
+typedef uintptr_t os_param_t;
+
+typedef struct {
+  os_signal_t sig;
+  os_param_t par;
+} os_event_t;
+
+typedef void (*os_task_t)(os_event_t *e);
+
+uint8_t
+system_get_cpu_freq();
+
+uint32_t
+system_get_time();
+
+bool
+system_os_task(os_task_t task, uint8_t prio, os_event_t *queue, uint8_t qlen);
+
+bool
+system_os_post(uint8_t prio, os_signal_t sig, os_param_t par);
+
+#endif //USER_INTERFACE_H
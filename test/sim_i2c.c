@@ -0,0 +1,334 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include "sim_i2c.h"
+
+
+/**
+ * Put next bit of the byte being sent on SDA.
+ *
+ * @param dev The device.
+ */
+static void
+mem_tx_bit(sim_i2c_mem *dev)
+{
+  dev->sda_low = (dev->byte & 0x80) == 0;
+  dev->byte <<= 1;
+  dev->bits++;
+}
+
+/**
+ * Load the next byte to send and put its MSB on SDA.
+ *
+ * @param dev The device.
+ */
+static void
+mem_tx_load(sim_i2c_mem *dev)
+{
+  dev->byte = dev->mem[dev->ptr];
+  dev->ptr = (uint16_t) ((dev->ptr + 1) % dev->size);
+  dev->bits = 0;
+  dev->tx++;
+  dev->state = SIM_I2C_TX;
+  mem_tx_bit(dev);
+}
+
+/**
+ * Store received byte.
+ *
+ * @param dev The device.
+ */
+static void
+mem_rx_byte(sim_i2c_mem *dev)
+{
+  uint16_t page;
+
+  dev->rx++;
+
+  if (dev->addr_got < dev->addr_len) {
+    if (dev->addr_got == 0) dev->ptr = 0;
+    dev->ptr = (uint16_t) (((dev->ptr << 8) | dev->byte) % dev->size);
+    dev->addr_got++;
+    return;
+  }
+
+  dev->mem[dev->ptr] = dev->byte;
+  dev->written = true;
+
+  // Writes wrap around within the page.
+  if (dev->page_size > 0) {
+    page = (uint16_t) (dev->ptr - dev->ptr % dev->page_size);
+    dev->ptr = (uint16_t) (page + (dev->ptr + 1) % dev->page_size);
+  } else {
+    dev->ptr = (uint16_t) ((dev->ptr + 1) % dev->size);
+  }
+}
+
+/**
+ * Handle SCL falling edge.
+ *
+ * @param dev The device.
+ * @param now The simulated time.
+ */
+static void
+mem_scl_fall(sim_i2c_mem *dev, uint64_t now)
+{
+  switch (dev->state) {
+    case SIM_I2C_ADDR:
+      if (dev->bits < 8) break;
+      if ((dev->byte >> 1) != dev->address) {
+        dev->state = SIM_I2C_IDLE;
+        break;
+      }
+      if (now < dev->busy_until) {
+        dev->busy_nacks++;
+        dev->state = SIM_I2C_IDLE;
+        break;
+      }
+      dev->rx++;
+      dev->reading = (dev->byte & 0x01) != 0;
+      dev->sda_low = true;
+      dev->state = SIM_I2C_ACK_OUT;
+      break;
+
+    case SIM_I2C_RX:
+      if (dev->bits < 8) break;
+      mem_rx_byte(dev);
+      dev->sda_low = true;
+      dev->state = SIM_I2C_ACK_OUT;
+      break;
+
+    case SIM_I2C_ACK_OUT:
+      dev->sda_low = false;
+      if (dev->stretch_us > 0) dev->stretch_until = now + HOST_US(dev->stretch_us);
+      if (dev->reading) {
+        mem_tx_load(dev);
+      } else {
+        dev->state = SIM_I2C_RX;
+        dev->byte = 0;
+        dev->bits = 0;
+      }
+      break;
+
+    case SIM_I2C_TX:
+      if (dev->bits < 8) {
+        mem_tx_bit(dev);
+      } else {
+        dev->sda_low = false;
+        dev->state = SIM_I2C_ACK_IN;
+      }
+      break;
+
+    case SIM_I2C_ACK_IN:
+      if (dev->master_ack) {
+        mem_tx_load(dev);
+      } else {
+        dev->state = SIM_I2C_IDLE;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+static uint32_t
+mem_drive(host_dev *hdev, uint64_t now)
+{
+  sim_i2c_mem *dev = (sim_i2c_mem *) hdev;
+  uint32_t low = 0;
+
+  if (dev->sda_low) low |= dev->sda_mask;
+  if (now < dev->stretch_until) low |= dev->scl_mask;
+
+  return low;
+}
+
+static void
+mem_edge(host_dev *hdev, uint32_t before, uint32_t after, uint64_t now)
+{
+  sim_i2c_mem *dev = (sim_i2c_mem *) hdev;
+  bool scl_before = (before & dev->scl_mask) != 0;
+  bool scl_after = (after & dev->scl_mask) != 0;
+  bool sda_before = (before & dev->sda_mask) != 0;
+  bool sda_after = (after & dev->sda_mask) != 0;
+
+  // SDA edge while SCL is high is START or STOP.
+  if (scl_before && scl_after && sda_before != sda_after) {
+    dev->sda_low = false;
+    if (!sda_after) {
+      dev->starts++;
+      dev->state = SIM_I2C_ADDR;
+      dev->byte = 0;
+      dev->bits = 0;
+      dev->addr_got = 0;
+    } else {
+      dev->stops++;
+      if (dev->written && dev->write_us > 0) dev->busy_until = now + HOST_US(dev->write_us);
+      dev->written = false;
+      dev->state = SIM_I2C_IDLE;
+    }
+    return;
+  }
+
+  if (!scl_before && scl_after) {
+    if (dev->state == SIM_I2C_ADDR || dev->state == SIM_I2C_RX) {
+      dev->byte = (uint8_t) ((dev->byte << 1) | sda_after);
+      dev->bits++;
+    } else if (dev->state == SIM_I2C_ACK_IN) {
+      dev->master_ack = !sda_after;
+    }
+  } else if (scl_before && !scl_after) {
+    mem_scl_fall(dev, now);
+  }
+}
+
+void
+sim_i2c_mem_init(sim_i2c_mem *dev, uint8_t scl_gpio, uint8_t sda_gpio, uint8_t address, uint8_t *mem, uint16_t size)
+{
+  os_memset(dev, 0, sizeof(sim_i2c_mem));
+
+  dev->dev.drive = mem_drive;
+  dev->dev.edge = mem_edge;
+  dev->scl_mask = (uint32_t) 0x1 << scl_gpio;
+  dev->sda_mask = (uint32_t) 0x1 << sda_gpio;
+  dev->address = address;
+  dev->addr_len = 1;
+  dev->mem = mem;
+  dev->size = size;
+  dev->state = SIM_I2C_IDLE;
+
+  host_attach(&dev->dev);
+}
+
+static uint32_t
+log_drive(host_dev *hdev, uint64_t now)
+{
+  (void) hdev;
+  (void) now;
+
+  return 0;
+}
+
+/**
+ * Record symbol.
+ *
+ * @param dev The device.
+ * @param sym The symbol.
+ */
+static void
+log_add(sim_i2c_log *dev, char sym)
+{
+  if (dev->len == SIM_I2C_LOG_MAX) return;
+
+  dev->log[dev->len++] = sym;
+  dev->log[dev->len] = 0;
+}
+
+static void
+log_edge(host_dev *hdev, uint32_t before, uint32_t after, uint64_t now)
+{
+  sim_i2c_log *dev = (sim_i2c_log *) hdev;
+  bool scl_before = (before & dev->scl_mask) != 0;
+  bool scl_after = (after & dev->scl_mask) != 0;
+  bool sda_before = (before & dev->sda_mask) != 0;
+  bool sda_after = (after & dev->sda_mask) != 0;
+
+  if (scl_before && scl_after && sda_before != sda_after) {
+    log_add(dev, (char) (sda_after ? 'P' : 'S'));
+  } else if (!scl_before && scl_after) {
+    log_add(dev, (char) (sda_after ? '1' : '0'));
+    dev->scl_rise = now;
+  } else if (scl_before && !scl_after) {
+    dev->scl_high = now - dev->scl_rise;
+  }
+}
+
+void
+sim_i2c_log_init(sim_i2c_log *dev, uint8_t scl_gpio, uint8_t sda_gpio)
+{
+  os_memset(dev, 0, sizeof(sim_i2c_log));
+
+  dev->dev.drive = log_drive;
+  dev->dev.edge = log_edge;
+  dev->scl_mask = (uint32_t) 0x1 << scl_gpio;
+  dev->sda_mask = (uint32_t) 0x1 << sda_gpio;
+
+  host_attach(&dev->dev);
+}
+
+void
+sim_i2c_log_clear(sim_i2c_log *dev)
+{
+  dev->len = 0;
+  dev->log[0] = 0;
+}
+
+static uint32_t
+rival_drive(host_dev *hdev, uint64_t now)
+{
+  sim_i2c_rival *dev = (sim_i2c_rival *) hdev;
+
+  return now < dev->drive_until ? dev->sda_mask : 0;
+}
+
+static void
+rival_edge(host_dev *hdev, uint32_t before, uint32_t after, uint64_t now)
+{
+  sim_i2c_rival *dev = (sim_i2c_rival *) hdev;
+  bool scl_before = (before & dev->scl_mask) != 0;
+  bool scl_after = (after & dev->scl_mask) != 0;
+
+  if (scl_before && scl_after && (before & dev->sda_mask) && !(after & dev->sda_mask)) {
+    dev->falls = 0;
+    return;
+  }
+
+  if (!scl_before || scl_after) return;
+
+  // Stop driving at the end of the bit.
+  if (now < dev->drive_until) dev->drive_until = now;
+
+  // The first fall after START starts the first bit.
+  if (dev->bit >= 0 && ++dev->falls == dev->bit + 1) {
+    // Released at the end of the bit or when the master gives up.
+    dev->drive_until = now + HOST_US(50);
+    dev->bit = -1;
+    dev->fired++;
+  }
+}
+
+void
+sim_i2c_rival_init(sim_i2c_rival *dev, uint8_t scl_gpio, uint8_t sda_gpio)
+{
+  os_memset(dev, 0, sizeof(sim_i2c_rival));
+
+  dev->dev.drive = rival_drive;
+  dev->dev.edge = rival_edge;
+  dev->scl_mask = (uint32_t) 0x1 << scl_gpio;
+  dev->sda_mask = (uint32_t) 0x1 << sda_gpio;
+  dev->bit = -1;
+
+  host_attach(&dev->dev);
+}
+
+void
+sim_i2c_rival_arm(sim_i2c_rival *dev, int16_t bit)
+{
+  dev->bit = bit;
+  dev->falls = 0;
+}
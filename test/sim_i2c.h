@@ -0,0 +1,155 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Simulated I2C devices for host tests.
+
+#ifndef SIM_I2C_H
+#define SIM_I2C_H
+
+#include "host.h"
+
+// Maximum number of symbols recorded by the bus log.
+#define SIM_I2C_LOG_MAX 2048
+
+// Memory device states.
+typedef enum {
+  SIM_I2C_IDLE,
+  SIM_I2C_ADDR,
+  SIM_I2C_RX,
+  SIM_I2C_ACK_OUT,
+  SIM_I2C_TX,
+  SIM_I2C_ACK_IN,
+} sim_i2c_state;
+
+// Simulated I2C memory (24Cxx EEPROM or register based sensor).
+//
+// After write address takes addr_len memory address bytes and then
+// writes memory sequentially. Reads continue from the memory address.
+// With page_size set writes wrap within the page and after STOP the
+// device does not acknowledge its address for write_us.
+typedef struct {
+  host_dev dev;             // The simulated device. Must be first.
+  uint32_t scl_mask;        // The SCL line mask.
+  uint32_t sda_mask;        // The SDA line mask.
+  uint8_t address;          // The 7 bit slave address.
+  uint8_t addr_len;         // The number of memory address bytes (1 or 2).
+  uint8_t *mem;             // The memory.
+  uint16_t size;            // The memory size.
+  uint16_t page_size;       // The write page size (0 - no pages).
+  uint32_t write_us;        // The write cycle after STOP in microseconds.
+  uint32_t stretch_us;      // The clock stretch after each acknowledged byte in microseconds.
+
+  // Device state.
+  sim_i2c_state state;
+  uint8_t byte;
+  uint8_t bits;
+  bool reading;
+  bool master_ack;
+  uint8_t addr_got;
+  uint16_t ptr;
+  bool written;
+  bool sda_low;
+  uint64_t stretch_until;
+  uint64_t busy_until;
+
+  // Statistics.
+  uint32_t starts;          // The number of START conditions.
+  uint32_t stops;           // The number of STOP conditions.
+  uint32_t rx;              // The number of received bytes (with address).
+  uint32_t tx;              // The number of sent bytes.
+  uint32_t busy_nacks;      // The number of addresses not acknowledged during write cycle.
+} sim_i2c_mem;
+
+// Bus log.
+//
+// Records what every slave sees on the bus: S for START,
+// P for STOP and 0 or 1 for SDA sampled at SCL rising edge.
+typedef struct {
+  host_dev dev;             // The simulated device. Must be first.
+  uint32_t scl_mask;        // The SCL line mask.
+  uint32_t sda_mask;        // The SDA line mask.
+  char log[SIM_I2C_LOG_MAX + 1]; // The recorded symbols.
+  uint16_t len;             // The number of recorded symbols.
+  uint64_t scl_high;        // The SCL high time in the last bit in CPU cycles.
+  uint64_t scl_rise;
+} sim_i2c_log;
+
+// Other master on the bus.
+//
+// Drives SDA low during the high clock of one bit
+// after START so the master loses arbitration.
+typedef struct {
+  host_dev dev;             // The simulated device. Must be first.
+  uint32_t scl_mask;        // The SCL line mask.
+  uint32_t sda_mask;        // The SDA line mask.
+  int16_t bit;              // The bit (0 - first address bit) to drive low or -1.
+  uint16_t falls;
+  uint64_t drive_until;
+  uint32_t fired;           // The number of times SDA was driven.
+} sim_i2c_rival;
+
+/**
+ * Initialize simulated memory and attach it to the lines.
+ *
+ * @param dev      The device.
+ * @param scl_gpio The SCL GPIO number.
+ * @param sda_gpio The SDA GPIO number.
+ * @param address  The 7 bit slave address.
+ * @param mem      The memory.
+ * @param size     The memory size.
+ */
+void
+sim_i2c_mem_init(sim_i2c_mem *dev, uint8_t scl_gpio, uint8_t sda_gpio, uint8_t address, uint8_t *mem, uint16_t size);
+
+/**
+ * Initialize bus log and attach it to the lines.
+ *
+ * @param dev      The device.
+ * @param scl_gpio The SCL GPIO number.
+ * @param sda_gpio The SDA GPIO number.
+ */
+void
+sim_i2c_log_init(sim_i2c_log *dev, uint8_t scl_gpio, uint8_t sda_gpio);
+
+/**
+ * Clear bus log.
+ *
+ * @param dev The device.
+ */
+void
+sim_i2c_log_clear(sim_i2c_log *dev);
+
+/**
+ * Initialize other master and attach it to the lines.
+ *
+ * @param dev      The device.
+ * @param scl_gpio The SCL GPIO number.
+ * @param sda_gpio The SDA GPIO number.
+ */
+void
+sim_i2c_rival_init(sim_i2c_rival *dev, uint8_t scl_gpio, uint8_t sda_gpio);
+
+/**
+ * Make other master win arbitration at the bit of next transaction.
+ *
+ * @param dev The device.
+ * @param bit The bit number after START (0 - first address bit).
+ */
+void
+sim_i2c_rival_arm(sim_i2c_rival *dev, int16_t bit);
+
+#endif //SIM_I2C_H
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <esp_ow.h>
+#include "sim_ow.h"
+
+// Reset pulse detected by the device.
+#define SIM_OW_RESET_US 400
+// Presence pulse start and end after reset pulse.
+#define SIM_OW_PD_START_US 20
+#define SIM_OW_PD_END_US 140
+// Low time read as 1.
+#define SIM_OW_ONE_US 15
+// Time the device holds line low to send 0.
+#define SIM_OW_ZERO_US 30
+
+
+/**
+ * Get bit sent in the current slot.
+ *
+ * @param dev The device.
+ *
+ * @return The bit.
+ */
+static bool
+ow_tx_bit(sim_ow_dev *dev)
+{
+  uint8_t idx = dev->bits;
+
+  switch (dev->state) {
+    case SIM_OW_READ_ROM:
+      return (dev->rom[idx >> 3] >> (idx & 0x07)) & 0x01;
+
+    case SIM_OW_SEARCH:
+      return ((dev->rom[idx >> 3] >> (idx & 0x07)) & 0x01) != (dev->phase == 1);
+
+    default:
+      return (dev->scratch[idx >> 3] >> (idx & 0x07)) & 0x01;
+  }
+}
+
+/**
+ * Check if the device sends in the current slot.
+ *
+ * @param dev The device.
+ *
+ * @return true if sending.
+ */
+static bool
+ow_is_tx(sim_ow_dev *dev)
+{
+  switch (dev->state) {
+    case SIM_OW_READ_ROM:
+    case SIM_OW_READ_SP:
+      return true;
+
+    case SIM_OW_SEARCH:
+      return dev->phase < 2;
+
+    default:
+      return false;
+  }
+}
+
+/**
+ * Advance state after sent bit.
+ *
+ * @param dev The device.
+ */
+static void
+ow_tx_done(sim_ow_dev *dev)
+{
+  switch (dev->state) {
+    case SIM_OW_READ_ROM:
+      if (++dev->bits == 64) dev->state = SIM_OW_IDLE;
+      break;
+
+    case SIM_OW_SEARCH:
+      dev->phase++;
+      break;
+
+    default:
+      if (++dev->bits == 72) dev->state = SIM_OW_IDLE;
+      break;
+  }
+}
+
+/**
+ * Handle received ROM command.
+ *
+ * @param dev The device.
+ */
+static void
+ow_rom_cmd(sim_ow_dev *dev)
+{
+  dev->bits = 0;
+  dev->phase = 0;
+
+  switch (dev->byte) {
+    case ESP_OW_CMD_READ_ROM:
+      dev->state = SIM_OW_READ_ROM;
+      break;
+
+    case ESP_OW_CMD_MATCH_ROM:
+      dev->state = SIM_OW_MATCH;
+      break;
+
+    case ESP_OW_CMD_SKIP_ROM:
+      dev->state = SIM_OW_FUNC_CMD;
+      break;
+
+    case ESP_OW_CMD_SEARCH_ROM:
+      dev->state = SIM_OW_SEARCH;
+      break;
+
+    case ESP_OW_CMD_SEARCH_ROM_ALERT:
+      dev->state = dev->alarm ? SIM_OW_SEARCH : SIM_OW_IDLE;
+      break;
+
+    default:
+      dev->state = SIM_OW_IDLE;
+      break;
+  }
+}
+
+/**
+ * Handle received bit.
+ *
+ * @param dev The device.
+ * @param bit The bit.
+ */
+static void
+ow_rx_bit(sim_ow_dev *dev, bool bit)
+{
+  uint8_t idx = dev->bits;
+
+  switch (dev->state) {
+    case SIM_OW_ROM_CMD:
+    case SIM_OW_FUNC_CMD:
+      dev->byte = (uint8_t) ((dev->byte >> 1) | (bit ? 0x80 : 0));
+      if (++dev->bits < 8) break;
+
+      if (dev->state == SIM_OW_ROM_CMD) {
+        ow_rom_cmd(dev);
+      } else {
+        dev->bits = 0;
+        dev->state = dev->byte == 0xBE ? SIM_OW_READ_SP : SIM_OW_IDLE;
+      }
+      break;
+
+    case SIM_OW_MATCH:
+      if (((dev->rom[idx >> 3] >> (idx & 0x07)) & 0x01) != bit) {
+        dev->state = SIM_OW_IDLE;
+      } else if (++dev->bits == 64) {
+        dev->bits = 0;
+        dev->state = SIM_OW_FUNC_CMD;
+      }
+      break;
+
+    case SIM_OW_SEARCH:
+      // Devices which do not match the direction leave the search.
+      dev->phase = 0;
+      if (((dev->rom[idx >> 3] >> (idx & 0x07)) & 0x01) != bit) {
+        dev->state = SIM_OW_IDLE;
+      } else if (++dev->bits == 64) {
+        dev->state = SIM_OW_IDLE;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+static uint32_t
+ow_drive(host_dev *hdev, uint64_t now)
+{
+  sim_ow_dev *dev = (sim_ow_dev *) hdev;
+
+  return now >= dev->drive_from && now < dev->drive_until ? dev->mask : 0;
+}
+
+static void
+ow_edge(host_dev *hdev, uint32_t before, uint32_t after, uint64_t now)
+{
+  sim_ow_dev *dev = (sim_ow_dev *) hdev;
+
+  if (((before ^ after) & dev->mask) == 0) return;
+
+  if ((after & dev->mask) == 0) {
+    // Slot starts with master driving the line low. Presence
+    // pulses are sent by all devices at the same time.
+    if (dev->low || ow_drive(hdev, now) != 0) return;
+
+    dev->low = true;
+    dev->fall = now;
+    dev->sending = dev->state != SIM_OW_IDLE && ow_is_tx(dev);
+    if (!dev->sending) return;
+
+    dev->slots++;
+    if (!ow_tx_bit(dev)) {
+      dev->drive_from = now;
+      dev->drive_until = now + HOST_US(SIM_OW_ZERO_US);
+    }
+    ow_tx_done(dev);
+    return;
+  }
+
+  if (!dev->low) return;
+  dev->low = false;
+
+  if (now - dev->fall >= HOST_US(SIM_OW_RESET_US)) {
+    dev->resets++;
+    dev->state = SIM_OW_ROM_CMD;
+    dev->byte = 0;
+    dev->bits = 0;
+    dev->drive_from = now + HOST_US(SIM_OW_PD_START_US);
+    dev->drive_until = now + HOST_US(SIM_OW_PD_END_US);
+    return;
+  }
+
+  if (dev->sending || dev->state == SIM_OW_IDLE) return;
+
+  dev->slots++;
+  ow_rx_bit(dev, now - dev->fall < HOST_US(SIM_OW_ONE_US));
+}
+
+void
+sim_ow_init(sim_ow_dev *dev, uint8_t gpio_num, const uint8_t *rom)
+{
+  uint8_t idx;
+  uint8_t crc = 0;
+
+  os_memset(dev, 0, sizeof(sim_ow_dev));
+
+  dev->dev.drive = ow_drive;
+  dev->dev.edge = ow_edge;
+  dev->mask = (uint32_t) 0x1 << gpio_num;
+
+  for (idx = 0; idx < 7; idx++) {
+    dev->rom[idx] = rom[idx];
+    crc = esp_ow_crc8(crc, rom[idx]);
+  }
+  dev->rom[7] = crc;
+
+  host_attach(&dev->dev);
+}
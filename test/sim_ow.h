@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Simulated OneWire devices for host tests.
+
+#ifndef SIM_OW_H
+#define SIM_OW_H
+
+#include "host.h"
+
+// Device states.
+typedef enum {
+  SIM_OW_IDLE,              // Waiting for reset.
+  SIM_OW_ROM_CMD,           // Receiving ROM command.
+  SIM_OW_MATCH,             // Receiving ROM address to match.
+  SIM_OW_READ_ROM,          // Sending ROM address.
+  SIM_OW_SEARCH,            // Search triplets.
+  SIM_OW_FUNC_CMD,          // Receiving function command.
+  SIM_OW_READ_SP,           // Sending scratchpad.
+} sim_ow_state;
+
+// Simulated OneWire device at standard speed.
+//
+// Answers reset with presence pulse, supports READ ROM, MATCH ROM,
+// SKIP ROM and both search commands. After selection the function
+// command 0xBE (read scratchpad) sends the scratchpad.
+typedef struct {
+  host_dev dev;             // The simulated device. Must be first.
+  uint32_t mask;            // The data line mask.
+  uint8_t rom[8];           // The ROM address.
+  uint8_t scratch[9];       // The scratchpad.
+  bool alarm;               // Answer ESP_OW_CMD_SEARCH_ROM_ALERT.
+
+  // Device state.
+  sim_ow_state state;
+  uint8_t byte;
+  uint8_t bits;
+  uint8_t phase;
+  bool low;
+  bool sending;
+  uint64_t fall;
+  uint64_t drive_from;
+  uint64_t drive_until;
+
+  // Statistics.
+  uint32_t resets;          // The number of reset pulses.
+  uint32_t slots;           // The number of bit slots.
+} sim_ow_dev;
+
+/**
+ * Attach OneWire device to the lines.
+ *
+ * The last ROM address byte is set to the CRC.
+ *
+ * @param dev      The device.
+ * @param gpio_num The data line GPIO.
+ * @param rom      The ROM address (first 7 bytes are used).
+ */
+void
+sim_ow_init(sim_ow_dev *dev, uint8_t gpio_num, const uint8_t *rom);
+
+#endif //SIM_OW_H
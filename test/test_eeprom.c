@@ -0,0 +1,207 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// 24Cxx EEPROM driver against simulated EEPROM.
+
+#include <esp_eeprom.h>
+#include <esp_gpio.h>
+#include "sim_i2c.h"
+
+#define SCL GPIO4
+#define SDA GPIO5
+#define ADDR 0x50
+
+// Simulated 24C32 write cycle in microseconds.
+#define WRITE_US 5000
+
+// Throughput benchmark length.
+#define BENCH_LEN 1024
+
+static esp_i2c_bus bus;
+static esp_eeprom ee;
+static sim_i2c_mem dev;
+static uint8_t mem[4096];
+
+// Stream consumer destination.
+static uint8_t stream[4096];
+static uint32_t stream_len;
+static uint16_t stream_calls;
+
+
+static void
+consumer(void *arg, uint8_t *buf, uint16_t len)
+{
+  (void) arg;
+  os_memcpy(&stream[stream_len], buf, len);
+  stream_len += len;
+  stream_calls++;
+}
+
+/**
+ * Start test with simulated 24C32 on the bus.
+ */
+static void
+setup(uint32_t speed)
+{
+  host_reset();
+  os_memset(mem, 0, sizeof(mem));
+  sim_i2c_mem_init(&dev, SCL, SDA, ADDR, mem, sizeof(mem));
+  dev.addr_len = 2;
+  dev.page_size = 32;
+  dev.write_us = WRITE_US;
+
+  CHECK(esp_i2c_bus_init(&bus, SCL, SDA) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_set_speed(&bus, speed) == ESP_I2C_OK);
+  CHECK(esp_eeprom_init(&ee, &bus, ADDR, ESP_EEPROM_24C32) == ESP_I2C_OK);
+
+  stream_len = 0;
+  stream_calls = 0;
+}
+
+static void
+test_page_write()
+{
+  uint16_t idx;
+  uint8_t buf[100];
+  uint8_t rd[100];
+  uint64_t start;
+  uint64_t elapsed;
+
+  setup(ESP_I2C_SPEED_400);
+  for (idx = 0; idx < sizeof(buf); idx++) buf[idx] = (uint8_t) (idx + 1);
+
+  // Pages: 20-31, 32-63, 64-95, 96-119.
+  start = host_now();
+  CHECK(esp_eeprom_write(&ee, 20, buf, sizeof(buf)) == ESP_I2C_OK);
+  CHECK(esp_eeprom_read(&ee, 20, rd, sizeof(rd)) == ESP_I2C_OK);
+  elapsed = host_now() - start;
+
+  CHECK(os_memcmp(rd, buf, sizeof(buf)) == 0);
+  CHECK(os_memcmp(&mem[20], buf, sizeof(buf)) == 0);
+  CHECK(mem[19] == 0);
+  CHECK(mem[120] == 0);
+  CHECK(ee.busy == false);
+
+  // Writes after the first and the read waited with ACK polling.
+  CHECK(dev.busy_nacks > 0);
+  // Acknowledged poll is followed by the memory address. Each NAK
+  // ends with STOP, 4 page writes and read add their own START
+  // and STOP and the read a repeated START.
+  CHECK(dev.starts == dev.busy_nacks + 4 + 2);
+  CHECK(dev.stops == dev.busy_nacks + 4 + 1);
+
+  // Every page is waited for about its write cycle only. The transfers
+  // take less than 5ms at 400kHz.
+  CHECK(elapsed >= HOST_US(4 * WRITE_US));
+  CHECK(elapsed < HOST_US(4 * WRITE_US + 8000));
+}
+
+static void
+test_read_stream()
+{
+  uint16_t idx;
+  uint8_t chunk[100];
+
+  setup(ESP_I2C_SPEED_400);
+  for (idx = 0; idx < sizeof(mem); idx++) mem[idx] = (uint8_t) (idx * 7);
+
+  // Whole memory in one transaction through small chunk buffer.
+  CHECK(esp_eeprom_read_stream(&ee, 0, sizeof(mem), chunk, sizeof(chunk), consumer, NULL) == ESP_I2C_OK);
+  CHECK(stream_len == sizeof(mem));
+  CHECK(stream_calls == (sizeof(mem) + sizeof(chunk) - 1) / sizeof(chunk));
+  CHECK(os_memcmp(stream, mem, sizeof(mem)) == 0);
+
+  CHECK(esp_eeprom_read_stream(&ee, 0, 10, chunk, 0, consumer, NULL) == ESP_I2C_ERR_BAD_ARG);
+  CHECK(esp_eeprom_read_stream(&ee, 4090, 10, chunk, sizeof(chunk), consumer, NULL) == ESP_I2C_ERR_BAD_ARG);
+  CHECK(!bus.in_trans);
+}
+
+static void
+test_bad_args()
+{
+  esp_eeprom bad;
+  uint8_t buf[2] = {0};
+
+  setup(ESP_I2C_SPEED_400);
+
+  CHECK(esp_eeprom_init(&bad, &bus, ADDR, 4096, 0) == ESP_I2C_ERR_BAD_ARG);
+  CHECK(esp_eeprom_write(&ee, 4095, buf, 2) == ESP_I2C_ERR_BAD_ARG);
+  CHECK(esp_eeprom_read(&ee, 4095, buf, 2) == ESP_I2C_ERR_BAD_ARG);
+  CHECK(dev.starts == 0);
+}
+
+static void
+test_write_timeout()
+{
+  uint8_t buf[2] = {1, 2};
+
+  setup(ESP_I2C_SPEED_400);
+  dev.write_us = 2 * ESP_EEPROM_WRITE_TIMEOUT_US;
+
+  CHECK(esp_eeprom_write(&ee, 0, buf, 1) == ESP_I2C_OK);
+  CHECK(esp_eeprom_write(&ee, 1, buf, 1) == ESP_I2C_ERR_NO_ACK);
+  CHECK(ee.busy);
+  CHECK(!bus.in_trans);
+}
+
+/**
+ * Print throughput in bytes per second of simulated time.
+ */
+static void
+test_throughput(uint32_t speed)
+{
+  uint16_t idx;
+  uint8_t chunk[64];
+  uint64_t start;
+  uint32_t wr_cycles;
+  uint32_t rd_cycles;
+
+  setup(speed);
+  for (idx = 0; idx < BENCH_LEN; idx++) stream[idx] = (uint8_t) (idx ^ 0x5A);
+
+  start = host_now();
+  CHECK(esp_eeprom_write(&ee, 0, stream, BENCH_LEN) == ESP_I2C_OK);
+  CHECK(esp_eeprom_wait(&ee) == ESP_I2C_OK);
+  wr_cycles = (uint32_t) (host_now() - start);
+  CHECK(os_memcmp(mem, stream, BENCH_LEN) == 0);
+
+  start = host_now();
+  CHECK(esp_eeprom_read_stream(&ee, 0, BENCH_LEN, chunk, sizeof(chunk), consumer, NULL) == ESP_I2C_OK);
+  rd_cycles = (uint32_t) (host_now() - start);
+  CHECK(stream_len == BENCH_LEN);
+
+  printf("%u Hz: write %u B/s, read %u B/s\n", speed,
+         (uint32_t) ((uint64_t) BENCH_LEN * HOST_CPU_MHZ * 1000000 / wr_cycles),
+         (uint32_t) ((uint64_t) BENCH_LEN * HOST_CPU_MHZ * 1000000 / rd_cycles));
+
+  // Writes are bound by the write cycle of every page.
+  CHECK(wr_cycles >= HOST_US((uint64_t) WRITE_US * BENCH_LEN / 32));
+  CHECK(rd_cycles < wr_cycles);
+}
+
+int
+main()
+{
+  test_page_write();
+  test_read_stream();
+  test_bad_args();
+  test_write_timeout();
+  test_throughput(ESP_I2C_SPEED_100);
+  test_throughput(ESP_I2C_SPEED_400);
+
+  return host_result();
+}
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Arbitration loss against other master on the bus.
+
+#include <esp_i2c.h>
+#include <esp_i2c_par.h>
+#include <esp_i2c_prog.h>
+#include <esp_gpio.h>
+#include "sim_i2c.h"
+
+#define SCL GPIO4
+#define SDA GPIO5
+#define SDA2 GPIO12
+#define ADDR 0x50
+
+// Other master drives SDA low at the third address bit (1).
+#define ARB_BIT 2
+
+static esp_i2c_bus bus;
+static sim_i2c_mem dev;
+static sim_i2c_rival rival;
+static uint8_t mem[256];
+
+
+/**
+ * Start test with simulated slave and other master on the bus.
+ */
+static void
+setup()
+{
+  host_reset();
+  os_memset(mem, 0, sizeof(mem));
+  sim_i2c_mem_init(&dev, SCL, SDA, ADDR, mem, sizeof(mem));
+  sim_i2c_rival_init(&rival, SCL, SDA);
+  CHECK(esp_i2c_bus_init(&bus, SCL, SDA) == ESP_I2C_OK);
+}
+
+/**
+ * Check the bus is released after other master finished.
+ */
+static bool
+bus_released()
+{
+  uint32_t both = ((uint32_t) 0x1 << SCL) | ((uint32_t) 0x1 << SDA);
+
+  host_idle(HOST_US(100));
+
+  return (host_lines() & both) == both;
+}
+
+static void
+test_transfer_retry()
+{
+  uint8_t buf[] = {0x10, 0xAB, 0xCD};
+  esp_i2c_msg msg = {ADDR, 0, sizeof(buf), buf};
+
+  setup();
+  esp_i2c_bus_set_retry(&bus, 3, ESP_I2C_RETRY_ON(ESP_I2C_ERR_ARB_LOST), 50);
+
+  sim_i2c_rival_arm(&rival, ARB_BIT);
+  CHECK(esp_i2c_bus_transfer(&bus, &msg, 1) == ESP_I2C_OK);
+
+  CHECK(rival.fired == 1);
+  CHECK(bus.stats.arb_lost == 1);
+  CHECK(bus.stats.retries == 1);
+  CHECK(mem[0x10] == 0xAB);
+  CHECK(mem[0x11] == 0xCD);
+  CHECK(!bus.in_trans);
+}
+
+static void
+test_transfer_no_retry()
+{
+  uint8_t buf[] = {0x10, 0xAB};
+  esp_i2c_msg msg = {ADDR, 0, sizeof(buf), buf};
+
+  setup();
+  esp_i2c_bus_set_retry(&bus, 0, 0, 0);
+
+  sim_i2c_rival_arm(&rival, ARB_BIT);
+  CHECK(esp_i2c_bus_transfer(&bus, &msg, 1) == ESP_I2C_ERR_ARB_LOST);
+
+  CHECK(bus.stats.arb_lost == 1);
+  CHECK(bus.stats.retries == 0);
+  CHECK(mem[0x10] == 0);
+  CHECK(!bus.in_trans);
+  CHECK(bus_released());
+}
+
+static void
+test_transfer_policy()
+{
+  uint8_t buf[] = {0x10, 0xAB};
+  esp_i2c_msg msg = {ADDR, 0, sizeof(buf), buf};
+  esp_i2c_retry once = {0, 0, 0};
+  esp_i2c_retry three = {3, ESP_I2C_RETRY_ON(ESP_I2C_ERR_ARB_LOST), 50};
+
+  setup();
+
+  // Transfer policy overrides bus default.
+  sim_i2c_rival_arm(&rival, ARB_BIT);
+  CHECK(esp_i2c_bus_transfer_retry(&bus, &msg, 1, &once) == ESP_I2C_ERR_ARB_LOST);
+  CHECK(bus.stats.retries == 0);
+  CHECK(mem[0x10] == 0);
+  CHECK(bus_released());
+
+  esp_i2c_bus_set_retry(&bus, 0, 0, 0);
+  sim_i2c_rival_arm(&rival, ARB_BIT);
+  CHECK(esp_i2c_bus_transfer_retry(&bus, &msg, 1, &three) == ESP_I2C_OK);
+  CHECK(bus.stats.arb_lost == 2);
+  CHECK(bus.stats.retries == 1);
+  CHECK(mem[0x10] == 0xAB);
+
+  // NULL uses bus default.
+  mem[0x10] = 0;
+  sim_i2c_rival_arm(&rival, ARB_BIT);
+  CHECK(esp_i2c_bus_transfer_retry(&bus, &msg, 1, NULL) == ESP_I2C_ERR_ARB_LOST);
+  CHECK(bus.stats.retries == 1);
+  CHECK(mem[0x10] == 0);
+}
+
+static void
+test_discover()
+{
+  esp_i2c_profile profiles[] = {
+      {.address = ADDR},
+      {.address = ESP_I2C_PROFILE_TEN(ADDR), .speed = ESP_I2C_SPEED_400},
+  };
+
+  setup();
+  mem[0x75] = 0x68;
+  esp_i2c_bus_set_profiles(&bus, profiles, 2);
+
+  // Lost arbitration is not retried and does not count as bad speed.
+  sim_i2c_rival_arm(&rival, ARB_BIT);
+  CHECK(esp_i2c_bus_discover_speed(&bus, ADDR, 0x75, NULL, 0) == ESP_I2C_ERR_ARB_LOST);
+  CHECK(bus.stats.retries == 0);
+  CHECK(profiles[0].speed == ESP_I2C_SPEED_100);
+  CHECK(bus_released());
+
+  // Bit timing can not be faster than the bit overhead.
+  bus.overhead = HOST_CPU_MHZ * 2;
+  CHECK(esp_i2c_bus_discover_speed(&bus, ADDR, 0x75, NULL, 0) == ESP_I2C_OK);
+  CHECK(profiles[0].speed == 500000);
+  CHECK(profiles[1].speed == ESP_I2C_SPEED_400);
+
+  // 7 and 10 bit devices with the same address have own profiles.
+  CHECK(esp_i2c_bus_start_ten(&bus, ADDR, false, true) == ESP_I2C_ERR_NO_ACK);
+  CHECK(bus.profile == &profiles[1]);
+  CHECK(bus.speed == ESP_I2C_SPEED_400);
+  CHECK(esp_i2c_bus_probe(&bus, ADDR) == ESP_I2C_OK);
+  CHECK(bus.profile == &profiles[0]);
+  CHECK(bus.speed == 500000);
+}
+
+static void
+test_sda_stuck()
+{
+  uint8_t buf[] = {0x10, 0xAB};
+  esp_i2c_msg msg = {ADDR, 0, sizeof(buf), buf};
+
+  setup();
+  esp_i2c_bus_set_retry(&bus, 0, 0, 0);
+
+  // SDA held low before START is a bus fault.
+  sim_i2c_rival_arm(&rival, -1);
+  rival.drive_until = host_now() + HOST_US(50);
+  CHECK(esp_i2c_bus_transfer(&bus, &msg, 1) == ESP_I2C_ERR_BUS_STUCK);
+  CHECK(bus.stats.arb_lost == 0);
+  CHECK(!bus.in_trans);
+  CHECK(bus_released());
+
+  // Default policy retries it.
+  esp_i2c_bus_init(&bus, SCL, SDA);
+  sim_i2c_rival_arm(&rival, -1);
+  rival.drive_until = host_now() + HOST_US(50);
+  CHECK(esp_i2c_bus_transfer(&bus, &msg, 1) == ESP_I2C_OK);
+  CHECK(bus.stats.arb_lost == 0);
+  CHECK(bus.stats.retries >= 1);
+  CHECK(mem[0x10] == 0xAB);
+}
+
+static void
+test_prog()
+{
+  esp_i2c_step steps[ESP_I2C_PROG_WRITE_STEPS(2)];
+  esp_i2c_prog prog;
+  uint8_t buf[] = {0x12, 0x34};
+
+  setup();
+
+  esp_i2c_prog_init(&prog, steps, sizeof(steps) / sizeof(steps[0]));
+  CHECK(esp_i2c_prog_write(&bus, &prog, ADDR, 0x20, buf, sizeof(buf)) == ESP_I2C_OK);
+
+  sim_i2c_rival_arm(&rival, ARB_BIT);
+  CHECK(esp_i2c_prog_run(&bus, &prog) == ESP_I2C_ERR_ARB_LOST);
+  CHECK(rival.fired == 1);
+  CHECK(bus.stats.arb_lost == 1);
+  CHECK(mem[0x20] == 0);
+  CHECK(!bus.in_trans);
+  CHECK(bus_released());
+
+  // The same program runs when the bus is free.
+  CHECK(esp_i2c_prog_run(&bus, &prog) == ESP_I2C_OK);
+  CHECK(mem[0x20] == 0x12);
+  CHECK(mem[0x21] == 0x34);
+  CHECK(bus.stats.arb_lost == 1);
+
+  // SDA held low before START is not lost arbitration.
+  sim_i2c_rival_arm(&rival, -1);
+  rival.drive_until = host_now() + HOST_US(50);
+  CHECK(esp_i2c_prog_run(&bus, &prog) == ESP_I2C_ERR_BUS_STUCK);
+  CHECK(bus.stats.arb_lost == 1);
+  CHECK(!bus.in_trans);
+}
+
+static void
+test_par()
+{
+  esp_i2c_par par;
+  sim_i2c_mem dev2;
+  sim_i2c_rival rival2;
+  uint8_t mem2[256];
+  uint8_t sdas[] = {SDA, SDA2};
+  uint8_t wr[] = {0x30};
+  uint8_t rd[2 * 2];
+  uint8_t acks;
+
+  setup();
+  os_memset(mem2, 0, sizeof(mem2));
+  sim_i2c_mem_init(&dev2, SCL, SDA2, ADDR, mem2, sizeof(mem2));
+
+  // Other master on the second lane only.
+  sim_i2c_rival_init(&rival2, SCL, SDA2);
+
+  mem[0x30] = 0x01;
+  mem[0x31] = 0x02;
+  mem2[0x30] = 0x03;
+  mem2[0x31] = 0x04;
+
+  CHECK(esp_i2c_par_init(&par, &bus, sdas, 2) == ESP_I2C_OK);
+
+  sim_i2c_rival_arm(&rival2, ARB_BIT);
+  CHECK(esp_i2c_par_transfer(&par, ADDR, wr, sizeof(wr), rd, 2, &acks) == ESP_I2C_ERR_ARB_LOST);
+  CHECK(rival2.fired == 1);
+  CHECK(bus.stats.arb_lost == 1);
+  CHECK(!bus.in_trans);
+  CHECK(bus_released());
+
+  CHECK(esp_i2c_par_transfer(&par, ADDR, wr, sizeof(wr), rd, 2, &acks) == ESP_I2C_OK);
+  CHECK(acks == 0x03);
+  CHECK(rd[0] == 0x01);
+  CHECK(rd[1] == 0x02);
+  CHECK(rd[2] == 0x03);
+  CHECK(rd[3] == 0x04);
+}
+
+int
+main()
+{
+  test_transfer_retry();
+  test_transfer_no_retry();
+  test_transfer_policy();
+  test_discover();
+  test_sda_stuck();
+  test_prog();
+  test_par();
+
+  return host_result();
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Asynchronous I2C engine against simulated slave.
+
+#include <esp_i2c.h>
+#include <user_interface.h>
+#include "sim_i2c.h"
+
+#define SCL GPIO4
+#define SDA GPIO5
+#define ADDR 0x50
+
+// Simulated FRC1 interrupt period in microseconds.
+#define FRC1_US 10
+
+static esp_i2c_bus bus;
+static sim_i2c_mem dev;
+static uint8_t mem[256];
+
+// Completion callback results.
+static uint8_t done;
+static esp_i2c_err result;
+static bool done_in_isr;
+
+// Simulated FRC1 interrupt state.
+static bool frc1_on;
+static bool in_frc1;
+
+
+static void
+on_done(esp_i2c_async *trans, esp_i2c_err err)
+{
+  (void) trans;
+  done++;
+  result = err;
+  if (in_frc1) done_in_isr = true;
+}
+
+/**
+ * Simulated FRC1 interrupt handler stepping the engine.
+ *
+ * @param arg The I2C bus.
+ */
+static void
+frc1_isr(void *arg)
+{
+  in_frc1 = true;
+  esp_i2c_bus_async_isr_step((esp_i2c_bus *) arg);
+  in_frc1 = false;
+
+  if (frc1_on) host_at(host_now() + HOST_US(FRC1_US), HOST_CHIP_MASTER, frc1_isr, arg);
+}
+
+/**
+ * Start test with simulated slave on the bus.
+ */
+static void
+setup()
+{
+  uint16_t idx;
+
+  host_reset();
+  for (idx = 0; idx < sizeof(mem); idx++) mem[idx] = (uint8_t) idx;
+  sim_i2c_mem_init(&dev, SCL, SDA, ADDR, mem, sizeof(mem));
+  CHECK(esp_i2c_bus_init(&bus, SCL, SDA) == ESP_I2C_OK);
+
+  done = 0;
+  result = ESP_I2C_OK;
+  done_in_isr = false;
+}
+
+/**
+ * Prepare transaction.
+ */
+static void
+trans_init(esp_i2c_async *trans, uint8_t address, uint8_t *wr_buf, uint16_t wr_len, uint8_t *rd_buf, uint16_t rd_len)
+{
+  os_memset(trans, 0, sizeof(esp_i2c_async));
+  trans->address = address;
+  trans->wr_buf = wr_buf;
+  trans->wr_len = wr_len;
+  trans->rd_buf = rd_buf;
+  trans->rd_len = rd_len;
+  trans->cb = on_done;
+}
+
+static void
+test_write_read()
+{
+  esp_i2c_async wr;
+  esp_i2c_async rd;
+  uint8_t wr_buf[] = {0x10, 0xAA, 0xBB, 0xCC};
+  uint8_t reg = 0x10;
+  uint8_t rd_buf[3] = {0};
+
+  setup();
+
+  // Queued transactions run in order.
+  trans_init(&wr, ADDR, wr_buf, sizeof(wr_buf), NULL, 0);
+  trans_init(&rd, ADDR, &reg, 1, rd_buf, sizeof(rd_buf));
+  CHECK(esp_i2c_bus_async_submit(&bus, &wr) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_async_submit(&bus, &rd) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_async_busy(&bus));
+
+  // Synchronous calls are rejected while the engine drives the bus.
+  CHECK(esp_i2c_bus_start(&bus) == ESP_I2C_ERR_BUSY);
+
+  CHECK(host_run_timers(HOST_US(1000000)));
+  CHECK(done == 2);
+  CHECK(wr.err == ESP_I2C_OK);
+  CHECK(rd.err == ESP_I2C_OK);
+  CHECK(!esp_i2c_bus_async_busy(&bus));
+  CHECK(!bus.in_trans);
+
+  CHECK(mem[0x10] == 0xAA && mem[0x11] == 0xBB && mem[0x12] == 0xCC);
+  CHECK(rd_buf[0] == 0xAA && rd_buf[1] == 0xBB && rd_buf[2] == 0xCC);
+  CHECK(dev.starts == 3 && dev.stops == 2);
+  CHECK(host_lines() & ((uint32_t) 0x1 << SCL));
+  CHECK(host_lines() & ((uint32_t) 0x1 << SDA));
+}
+
+static void
+test_no_ack()
+{
+  esp_i2c_async trans;
+  uint8_t buf[] = {0x00, 0x01};
+
+  setup();
+
+  trans_init(&trans, ADDR + 1, buf, sizeof(buf), NULL, 0);
+  CHECK(esp_i2c_bus_async_submit(&bus, &trans) == ESP_I2C_OK);
+  CHECK(host_run_timers(HOST_US(1000000)));
+
+  CHECK(done == 1);
+  CHECK(result == ESP_I2C_ERR_NO_ACK);
+  CHECK(dev.stops == 1);
+  CHECK(mem[0] == 0x00 && mem[1] == 0x01);
+}
+
+static void
+test_stretch()
+{
+  esp_i2c_async trans;
+  uint8_t reg = 0x20;
+  uint8_t buf[2];
+
+  setup();
+
+  // Stretches shorter than the limit are waited out tick by tick.
+  dev.stretch_us = 600;
+  trans_init(&trans, ADDR, &reg, 1, buf, sizeof(buf));
+  CHECK(esp_i2c_bus_async_submit(&bus, &trans) == ESP_I2C_OK);
+  CHECK(host_run_timers(HOST_US(1000000)));
+  CHECK(result == ESP_I2C_OK);
+  CHECK(buf[0] == 0x20 && buf[1] == 0x21);
+  CHECK(bus.stats.cs_count > 0);
+  CHECK(bus.stats.cs_max_us >= 300);
+
+  // Longer stretches fail the transaction.
+  dev.stretch_us = 2000;
+  trans_init(&trans, ADDR, &reg, 1, buf, sizeof(buf));
+  CHECK(esp_i2c_bus_async_submit(&bus, &trans) == ESP_I2C_OK);
+  CHECK(host_run_timers(HOST_US(1000000)));
+  CHECK(result == ESP_I2C_ERR_LONG_STRETCH);
+  CHECK(bus.stats.cs_timeouts == 1);
+  CHECK(!bus.in_trans);
+}
+
+static void
+test_manual_step()
+{
+  esp_i2c_async trans;
+  uint8_t buf[] = {0x30, 0x55};
+  uint32_t steps = 0;
+
+  setup();
+
+  // The os_timer can not keep shorter ticks.
+  CHECK(bus.async_tick_us == ESP_I2C_ASYNC_MIN_TICK_US);
+  CHECK(esp_i2c_bus_async_set_tick(&bus, 25) == ESP_I2C_ERR_BAD_ARG);
+  CHECK(bus.async_tick_us == ESP_I2C_ASYNC_MIN_TICK_US);
+
+  // Without timer the caller drives the engine.
+  CHECK(esp_i2c_bus_async_set_tick(&bus, 0) == ESP_I2C_OK);
+  trans_init(&trans, ADDR, buf, sizeof(buf), NULL, 0);
+  CHECK(esp_i2c_bus_async_submit(&bus, &trans) == ESP_I2C_OK);
+  CHECK(!host_run_timers(HOST_US(1000000)) || done == 0);
+
+  while (esp_i2c_bus_async_busy(&bus) && steps < 1000) {
+    esp_i2c_bus_async_step(&bus);
+    host_idle(HOST_US(10));
+    steps++;
+  }
+
+  CHECK(done == 1);
+  CHECK(result == ESP_I2C_OK);
+  CHECK(mem[0x30] == 0x55);
+  // START, 2 bytes with ACK and STOP in quarter bit ticks.
+  CHECK(steps > 2 * 9 * 4);
+}
+
+static void
+test_isr_step()
+{
+  esp_i2c_async wr;
+  esp_i2c_async rd;
+  uint8_t wr_buf[] = {0x50, 0x11, 0x22};
+  uint8_t reg = 0x50;
+  uint8_t rd_buf[2] = {0};
+  uint64_t start;
+
+  setup();
+
+  CHECK(esp_i2c_async_isr_init(USER_TASK_PRIO_1) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_async_set_tick(&bus, 0) == ESP_I2C_OK);
+
+  trans_init(&wr, ADDR, wr_buf, sizeof(wr_buf), NULL, 0);
+  trans_init(&rd, ADDR, &reg, 1, rd_buf, sizeof(rd_buf));
+  CHECK(esp_i2c_bus_async_submit(&bus, &wr) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_async_submit(&bus, &rd) == ESP_I2C_OK);
+
+  // Interrupt drives the bus, the task finishes transactions.
+  frc1_on = true;
+  host_at(host_now() + HOST_US(FRC1_US), HOST_CHIP_MASTER, frc1_isr, &bus);
+
+  start = host_now();
+  while (esp_i2c_bus_async_busy(&bus) && host_now() - start < HOST_US(100000)) {
+    host_idle(HOST_US(FRC1_US));
+    host_run_tasks();
+  }
+  frc1_on = false;
+
+  CHECK(done == 2);
+  CHECK(!done_in_isr);
+  CHECK(wr.err == ESP_I2C_OK);
+  CHECK(rd.err == ESP_I2C_OK);
+  CHECK(mem[0x50] == 0x11 && mem[0x51] == 0x22);
+  CHECK(rd_buf[0] == 0x11 && rd_buf[1] == 0x22);
+  CHECK(!bus.in_trans);
+
+  printf("isr step: %u us for 3 byte write\n", wr.total_cycles / HOST_CPU_MHZ);
+
+  // START, address, 3 bytes with ACK and STOP at quarter bit per interrupt.
+  CHECK(wr.total_cycles < HOST_US(FRC1_US * (4 * 9 * 4 + 10)));
+}
+
+static void
+test_cpu_time()
+{
+  esp_i2c_async trans;
+  esp_i2c_msg msgs[2];
+  uint8_t reg = 0x40;
+  uint8_t buf[16];
+  uint64_t start;
+  uint64_t sync_cycles;
+
+  setup();
+
+  // Synchronous transfer keeps the CPU for the whole time.
+  msgs[0].address = ADDR;
+  msgs[0].flags = 0;
+  msgs[0].len = 1;
+  msgs[0].buf = &reg;
+  msgs[1].address = ADDR;
+  msgs[1].flags = ESP_I2C_M_RD;
+  msgs[1].len = sizeof(buf);
+  msgs[1].buf = buf;
+
+  start = host_now();
+  CHECK(esp_i2c_bus_transfer(&bus, msgs, 2) == ESP_I2C_OK);
+  sync_cycles = host_now() - start;
+  CHECK(buf[0] == 0x40 && buf[15] == 0x4F);
+
+  trans_init(&trans, ADDR, &reg, 1, buf, sizeof(buf));
+  os_memset(buf, 0, sizeof(buf));
+  CHECK(esp_i2c_bus_async_submit(&bus, &trans) == ESP_I2C_OK);
+  CHECK(host_run_timers(HOST_US(1000000)));
+  CHECK(result == ESP_I2C_OK);
+  CHECK(buf[0] == 0x40 && buf[15] == 0x4F);
+
+  printf("sync transfer: %u cycles busy\n", (uint32_t) sync_cycles);
+  printf("async transfer: %u of %u cycles busy (%u.%u%%)\n",
+         trans.busy_cycles, trans.total_cycles,
+         trans.busy_cycles * 100 / trans.total_cycles,
+         trans.busy_cycles * 1000 / trans.total_cycles % 10);
+
+  // Each tick only toggles a line so most of the transfer time is free.
+  CHECK(trans.busy_cycles * 10 < trans.total_cycles);
+  CHECK(trans.busy_cycles * 10 < sync_cycles);
+}
+
+int
+main()
+{
+  test_write_read();
+  test_no_ack();
+  test_stretch();
+  test_manual_step();
+  test_isr_step();
+  test_cpu_time();
+
+  return host_result();
+}
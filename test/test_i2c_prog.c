@@ -0,0 +1,165 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Compiled transactions against the bit by bit path.
+
+#include <esp_i2c.h>
+#include <esp_i2c_prog.h>
+#include "sim_i2c.h"
+
+#define SCL GPIO4
+#define SDA GPIO5
+#define ADDR 0x50
+
+static esp_i2c_bus bus;
+static sim_i2c_mem dev;
+static sim_i2c_log log_dev;
+static uint8_t mem[256];
+
+
+/**
+ * Start test with simulated slave and bus log on the bus.
+ */
+static void
+setup()
+{
+  host_reset();
+  os_memset(mem, 0, sizeof(mem));
+  sim_i2c_mem_init(&dev, SCL, SDA, ADDR, mem, sizeof(mem));
+  sim_i2c_log_init(&log_dev, SCL, SDA);
+  CHECK(esp_i2c_bus_init(&bus, SCL, SDA) == ESP_I2C_OK);
+}
+
+/**
+ * Write to the register bit by bit.
+ */
+static esp_i2c_err
+bit_write(uint8_t address, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_start_write(&bus, address, reg);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_write_bytes(&bus, buf, len);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(&bus);
+}
+
+static void
+test_same_edges(uint32_t speed)
+{
+  esp_i2c_step steps[ESP_I2C_PROG_WRITE_STEPS(4)];
+  esp_i2c_prog prog;
+  uint8_t buf[] = {0x00, 0xFF, 0xA5, 0x5A};
+  char bit_log[SIM_I2C_LOG_MAX + 1];
+  uint64_t start;
+  uint64_t bit_cycles;
+  uint64_t prog_cycles;
+
+  setup();
+  CHECK(esp_i2c_bus_set_speed(&bus, speed) == ESP_I2C_OK);
+
+  // STOP leaves SCL low so compare transactions which
+  // both start after previous one.
+  CHECK(bit_write(ADDR, 0x00, buf, 1) == ESP_I2C_OK);
+  sim_i2c_log_clear(&log_dev);
+
+  start = host_now();
+  CHECK(bit_write(ADDR, 0x10, buf, sizeof(buf)) == ESP_I2C_OK);
+  bit_cycles = host_now() - start;
+  os_memcpy(bit_log, log_dev.log, sizeof(bit_log));
+  CHECK(os_memcmp(&mem[0x10], buf, sizeof(buf)) == 0);
+
+  os_memset(mem, 0, sizeof(mem));
+  sim_i2c_log_clear(&log_dev);
+
+  esp_i2c_prog_init(&prog, steps, sizeof(steps) / sizeof(steps[0]));
+  CHECK(esp_i2c_prog_write(&bus, &prog, ADDR, 0x10, buf, sizeof(buf)) == ESP_I2C_OK);
+  start = host_now();
+  CHECK(esp_i2c_prog_run(&bus, &prog) == ESP_I2C_OK);
+  prog_cycles = host_now() - start;
+  CHECK(os_memcmp(&mem[0x10], buf, sizeof(buf)) == 0);
+  CHECK(!bus.in_trans);
+
+  // Clock release, START, address, register, 4 bytes with ACK and STOP.
+  CHECK(strlen(bit_log) == 1 + 1 + 6 * 9 + 2);
+  CHECK(strcmp(bit_log, log_dev.log) == 0);
+  if (strcmp(bit_log, log_dev.log) != 0) printf("bits: %s\nprog: %s\n", bit_log, log_dev.log);
+
+  printf("%u Hz: bit by bit %u cycles, compiled %u cycles\n",
+         speed, (uint32_t) bit_cycles, (uint32_t) prog_cycles);
+
+  // Same delays so the transaction takes about the same time.
+  CHECK(prog_cycles * 10 <= bit_cycles * 11);
+  CHECK(prog_cycles * 10 >= bit_cycles * 9);
+}
+
+static void
+test_no_ack()
+{
+  esp_i2c_step steps[ESP_I2C_PROG_WRITE_STEPS(1)];
+  esp_i2c_prog prog;
+  uint8_t buf[] = {0x11};
+  char bit_log[SIM_I2C_LOG_MAX + 1];
+
+  setup();
+  CHECK(bit_write(ADDR, 0x00, buf, 1) == ESP_I2C_OK);
+  sim_i2c_log_clear(&log_dev);
+
+  CHECK(bit_write(ADDR + 1, 0x10, buf, sizeof(buf)) == ESP_I2C_ERR_NO_ACK);
+  os_memcpy(bit_log, log_dev.log, sizeof(bit_log));
+  sim_i2c_log_clear(&log_dev);
+
+  esp_i2c_prog_init(&prog, steps, sizeof(steps) / sizeof(steps[0]));
+  CHECK(esp_i2c_prog_write(&bus, &prog, ADDR + 1, 0x10, buf, sizeof(buf)) == ESP_I2C_OK);
+  CHECK(esp_i2c_prog_run(&bus, &prog) == ESP_I2C_ERR_NO_ACK);
+  CHECK(!bus.in_trans);
+
+  // Both stop after not acknowledged address and release
+  // the bus. Program starts from released bus.
+  CHECK(strcmp(bit_log, "1S1010001010P1") == 0);
+  CHECK(strcmp(log_dev.log, "S1010001010P1") == 0);
+}
+
+static void
+test_steps_size()
+{
+  esp_i2c_step steps[ESP_I2C_PROG_WRITE_STEPS(2)];
+  esp_i2c_prog prog;
+  uint8_t buf[] = {0xFF, 0xFF, 0xFF};
+
+  setup();
+
+  // All ones is the longest byte.
+  esp_i2c_prog_init(&prog, steps, sizeof(steps) / sizeof(steps[0]));
+  CHECK(esp_i2c_prog_write(&bus, &prog, 0x7F, 0xFF, buf, 2) == ESP_I2C_OK);
+  CHECK(esp_i2c_prog_write(&bus, &prog, 0x7F, 0xFF, buf, 3) == ESP_I2C_ERR_MEM);
+  CHECK(prog.len == 0);
+}
+
+int
+main()
+{
+  test_same_edges(ESP_I2C_SPEED_100);
+  test_same_edges(ESP_I2C_SPEED_400);
+  test_no_ack();
+  test_steps_size();
+
+  return host_result();
+}
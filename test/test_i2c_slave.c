@@ -0,0 +1,223 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Interrupt driven I2C slave against master on the other chip.
+
+#include <esp_i2c.h>
+#include <esp_i2c_slave.h>
+#include <esp_gpio.h>
+#include "sim_i2c.h"
+
+#define SCL GPIO4
+#define SDA GPIO5
+#define ADDR 0x42
+
+// Time application takes to prepare the response.
+#define PREPARE_US 300
+
+static esp_i2c_bus bus;
+static esp_i2c_slave slave;
+static uint8_t regs[16];
+
+// Callback results.
+static uint8_t writes;
+static uint8_t write_reg;
+static uint16_t write_len;
+static uint8_t reads;
+static bool deferred;
+
+
+/**
+ * Fill the response and finish clock stretching.
+ *
+ * Runs on the slave chip.
+ */
+static void
+prepare(void *arg)
+{
+  regs[8] = 0xC0;
+  regs[9] = 0xDE;
+  esp_i2c_slave_ready((esp_i2c_slave *) arg);
+}
+
+static bool
+on_event(esp_i2c_slave *sl, esp_i2c_slave_ev ev, uint8_t reg, uint16_t len)
+{
+  if (ev == ESP_I2C_SLAVE_EV_WRITE) {
+    writes++;
+    write_reg = reg;
+    write_len = len;
+    return true;
+  }
+
+  reads++;
+  if (!deferred) return true;
+
+  host_at(host_now() + HOST_US(PREPARE_US), HOST_CHIP_SLAVE, prepare, sl);
+
+  return false;
+}
+
+/**
+ * Start test with slave on the other chip.
+ */
+static void
+setup()
+{
+  uint8_t idx;
+
+  host_reset();
+  for (idx = 0; idx < sizeof(regs); idx++) regs[idx] = (uint8_t) (0xA0 + idx);
+
+  host_set_chip(HOST_CHIP_SLAVE);
+  CHECK(esp_i2c_slave_init(&slave, SCL, SDA, ADDR, regs, sizeof(regs), on_event) == ESP_I2C_OK);
+  host_set_chip(HOST_CHIP_MASTER);
+  CHECK(esp_i2c_bus_init(&bus, SCL, SDA) == ESP_I2C_OK);
+
+  writes = 0;
+  reads = 0;
+  deferred = false;
+}
+
+/**
+ * Read bytes from the slave register window.
+ */
+static esp_i2c_err
+read_regs(uint8_t address, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+  esp_i2c_err err;
+
+  err = esp_i2c_bus_start_read(&bus, address, reg);
+  if (err != ESP_I2C_OK) return err;
+
+  err = esp_i2c_bus_read_bytes(&bus, buf, len);
+  if (err != ESP_I2C_OK) return err;
+
+  return esp_i2c_bus_stop(&bus);
+}
+
+static void
+test_write()
+{
+  uint8_t buf[] = {0x11, 0x22, 0x33};
+
+  setup();
+
+  CHECK(esp_i2c_bus_start_write(&bus, ADDR, 3) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_write_bytes(&bus, buf, sizeof(buf)) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_stop(&bus) == ESP_I2C_OK);
+
+  CHECK(os_memcmp(&regs[3], buf, sizeof(buf)) == 0);
+  CHECK(regs[2] == 0xA2);
+  CHECK(regs[6] == 0xA6);
+  CHECK(writes == 1);
+  CHECK(write_reg == 3);
+  CHECK(write_len == sizeof(buf));
+  CHECK(slave.state == ESP_I2C_SLAVE_IDLE);
+
+  // Pointer wraps around at the window size.
+  CHECK(esp_i2c_bus_start_write(&bus, ADDR, 15) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_write_bytes(&bus, buf, 2) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_stop(&bus) == ESP_I2C_OK);
+  CHECK(regs[15] == 0x11);
+  CHECK(regs[0] == 0x22);
+}
+
+static void
+test_read()
+{
+  uint8_t buf[4];
+
+  setup();
+
+  CHECK(read_regs(ADDR, 4, buf, sizeof(buf)) == ESP_I2C_OK);
+  CHECK(buf[0] == 0xA4);
+  CHECK(buf[3] == 0xA7);
+  CHECK(reads == 1);
+  CHECK(slave.state == ESP_I2C_SLAVE_IDLE);
+
+  printf("first byte latency: %u cycles\n", slave.first_byte_cycles);
+
+  // Response ready in the callback stretches the clock
+  // for less than the master clock cycle.
+  CHECK(slave.first_byte_cycles < HOST_US(10));
+  CHECK(bus.stats.cs_timeouts == 0);
+}
+
+static void
+test_deferred()
+{
+  uint8_t buf[2];
+
+  setup();
+  deferred = true;
+
+  CHECK(read_regs(ADDR, 8, buf, sizeof(buf)) == ESP_I2C_OK);
+  CHECK(buf[0] == 0xC0);
+  CHECK(buf[1] == 0xDE);
+
+  // Master waited for the application.
+  CHECK(slave.first_byte_cycles >= HOST_US(PREPARE_US));
+  CHECK(slave.first_byte_cycles < HOST_US(PREPARE_US + 10));
+  // Stretch starts at SCL falling edge after ACK. Master
+  // releases SCL later in the clock cycle.
+  CHECK(bus.stats.cs_count == 1);
+  CHECK(bus.stats.cs_max_us + 10 >= PREPARE_US);
+  CHECK(bus.stats.cs_timeouts == 0);
+}
+
+static void
+test_not_addressed()
+{
+  uint8_t buf[] = {0x55};
+  uint8_t other_mem[16] = {0};
+  uint8_t rd[2];
+  sim_i2c_mem other;
+
+  setup();
+
+  CHECK(esp_i2c_bus_start_write(&bus, ADDR + 2, 0) == ESP_I2C_ERR_NO_ACK);
+  CHECK(slave.state == ESP_I2C_SLAVE_IDLE);
+
+  // Transfers with other device do not touch the lines.
+  sim_i2c_mem_init(&other, SCL, SDA, ADDR + 1, other_mem, sizeof(other_mem));
+  CHECK(esp_i2c_bus_start_write(&bus, ADDR + 1, 4) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_write_bytes(&bus, buf, sizeof(buf)) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_stop(&bus) == ESP_I2C_OK);
+  CHECK(read_regs(ADDR + 1, 4, rd, sizeof(rd)) == ESP_I2C_OK);
+  CHECK(rd[0] == 0x55);
+  CHECK(slave.state == ESP_I2C_SLAVE_IDLE);
+  CHECK(host_drove(HOST_CHIP_SLAVE) == 0);
+
+  // Slave still answers its own address.
+  CHECK(esp_i2c_bus_start_write(&bus, ADDR, 0) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_write_bytes(&bus, buf, sizeof(buf)) == ESP_I2C_OK);
+  CHECK(esp_i2c_bus_stop(&bus) == ESP_I2C_OK);
+  CHECK(regs[0] == 0x55);
+  CHECK(writes == 1);
+}
+
+int
+main()
+{
+  test_write();
+  test_read();
+  test_deferred();
+  test_not_addressed();
+
+  return host_result();
+}
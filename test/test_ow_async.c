@@ -0,0 +1,278 @@
+/*
+ * Copyright 2017 Rafal Zajac <rzajac@gmail.com>.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+// Asynchronous OneWire engine against simulated devices.
+
+#include <esp_ow.h>
+#include <esp_ow_async.h>
+#include <esp_gpio.h>
+#include "sim_ow.h"
+
+#define OW GPIO4
+#define DEVS 4
+
+static sim_ow_dev devs[DEVS];
+
+static const uint8_t roms[DEVS][7] = {
+  {0x28, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06},
+  {0x28, 0x81, 0x02, 0x03, 0x04, 0x05, 0x06},
+  {0x10, 0xAA, 0x55, 0x00, 0xFF, 0x12, 0x34},
+  {0x3B, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
+
+// Completion callback results.
+static uint8_t done;
+static esp_ow_err result;
+
+// Search results.
+static uint8_t found[DEVS + 1][8];
+static uint8_t found_cnt;
+
+
+static void
+on_done(esp_ow_async *trans, esp_ow_err err)
+{
+  (void) trans;
+  done++;
+  result = err;
+}
+
+static void
+on_search(esp_ow_async *trans, esp_ow_err err)
+{
+  result = err;
+
+  if (err == ESP_OW_OK && found_cnt <= DEVS) os_memcpy(found[found_cnt++], trans->rom, 8);
+  if (err == ESP_OW_OK && !trans->last) {
+    esp_ow_async_submit(trans);
+    return;
+  }
+
+  done++;
+}
+
+/**
+ * Start test with devs_cnt simulated devices on the bus.
+ */
+static void
+setup(uint8_t devs_cnt)
+{
+  uint8_t idx;
+  uint8_t byte;
+
+  host_reset();
+  for (idx = 0; idx < devs_cnt; idx++) {
+    sim_ow_init(&devs[idx], OW, roms[idx]);
+    for (byte = 0; byte < sizeof(devs[idx].scratch); byte++) {
+      devs[idx].scratch[byte] = (uint8_t) (idx * 16 + byte);
+    }
+  }
+  esp_ow_init(OW);
+
+  done = 0;
+  result = ESP_OW_OK;
+  found_cnt = 0;
+}
+
+/**
+ * Prepare transaction.
+ */
+static void
+trans_init(esp_ow_async *trans, bool reset, uint8_t *wr_buf, uint16_t wr_len, uint8_t *rd_buf, uint16_t rd_len)
+{
+  os_memset(trans, 0, sizeof(esp_ow_async));
+  trans->gpio_num = OW;
+  trans->reset = reset;
+  trans->wr_buf = wr_buf;
+  trans->wr_len = wr_len;
+  trans->rd_buf = rd_buf;
+  trans->rd_len = rd_len;
+  trans->cb = on_done;
+}
+
+/**
+ * Run timers till all transactions finish.
+ */
+static void
+run()
+{
+  CHECK(host_run_timers(host_now() + HOST_US(1000000)));
+  CHECK(!esp_ow_async_busy(OW));
+}
+
+/**
+ * Check if ROM address was found exactly once.
+ */
+static bool
+found_once(const uint8_t *rom)
+{
+  uint8_t idx;
+  uint8_t cnt = 0;
+
+  for (idx = 0; idx < found_cnt; idx++) {
+    if (os_memcmp(found[idx], rom, 8) == 0) cnt++;
+  }
+
+  return cnt == 1;
+}
+
+static void
+test_search()
+{
+  esp_ow_async trans;
+  uint8_t idx;
+
+  setup(DEVS);
+
+  trans_init(&trans, true, NULL, 0, NULL, 0);
+  trans.search = ESP_OW_CMD_SEARCH_ROM;
+  trans.cb = on_search;
+  CHECK(esp_ow_async_submit(&trans) == ESP_OW_OK);
+  run();
+
+  CHECK(done == 1);
+  CHECK(result == ESP_OW_OK);
+  CHECK(trans.last);
+  CHECK(found_cnt == DEVS);
+  for (idx = 0; idx < DEVS; idx++) {
+    CHECK(found_once(devs[idx].rom));
+    CHECK(devs[idx].resets == DEVS);
+  }
+
+  // Only the devices in alarm state answer.
+  setup(DEVS);
+  devs[2].alarm = true;
+
+  trans_init(&trans, true, NULL, 0, NULL, 0);
+  trans.search = ESP_OW_CMD_SEARCH_ROM_ALERT;
+  trans.cb = on_search;
+  CHECK(esp_ow_async_submit(&trans) == ESP_OW_OK);
+  run();
+
+  CHECK(result == ESP_OW_OK);
+  CHECK(found_cnt == 1);
+  CHECK(found_once(devs[2].rom));
+}
+
+static void
+test_match_read()
+{
+  esp_ow_async trans;
+  uint8_t wr[10];
+  uint8_t rd[9];
+
+  setup(DEVS);
+
+  wr[0] = ESP_OW_CMD_MATCH_ROM;
+  os_memcpy(&wr[1], devs[1].rom, 8);
+  wr[9] = 0xBE;
+
+  trans_init(&trans, true, wr, sizeof(wr), rd, sizeof(rd));
+  CHECK(esp_ow_async_submit(&trans) == ESP_OW_OK);
+  run();
+
+  CHECK(done == 1);
+  CHECK(result == ESP_OW_OK);
+  CHECK(os_memcmp(rd, devs[1].scratch, sizeof(rd)) == 0);
+  CHECK(devs[0].state == SIM_OW_IDLE);
+}
+
+static void
+test_no_dev()
+{
+  esp_ow_async trans;
+  uint8_t wr[] = {ESP_OW_CMD_SKIP_ROM};
+
+  setup(0);
+
+  trans_init(&trans, true, wr, sizeof(wr), NULL, 0);
+  CHECK(esp_ow_async_submit(&trans) == ESP_OW_OK);
+  run();
+
+  CHECK(done == 1);
+  CHECK(result == ESP_OW_ERR_NO_DEV);
+}
+
+/**
+ * Measure CPU time the engine holds per byte.
+ */
+static void
+cpu_time(const char *name, uint8_t *wr_buf, uint16_t wr_len, uint8_t *rd_buf, uint16_t rd_len)
+{
+  esp_ow_async trans;
+  uint16_t len = (uint16_t) (wr_len + rd_len);
+
+  setup(1);
+
+  trans_init(&trans, false, wr_buf, wr_len, rd_buf, rd_len);
+  CHECK(esp_ow_async_submit(&trans) == ESP_OW_OK);
+  run();
+  CHECK(result == ESP_OW_OK);
+
+  printf("%s: busy %u us/byte of %u us/byte\n", name,
+         trans.busy_cycles / len / HOST_CPU_MHZ, trans.total_cycles / len / HOST_CPU_MHZ);
+
+  // Every slot takes at least 60us. Transaction ends
+  // before the last slot recovery.
+  CHECK(trans.total_cycles >= HOST_US(60 * 8) * len - HOST_US(60));
+}
+
+static void
+test_cpu_time()
+{
+  esp_ow_async trans;
+  uint8_t ones[16];
+  uint8_t zeros[16];
+  uint8_t rd[16];
+
+  os_memset(ones, 0xFF, sizeof(ones));
+  os_memset(zeros, 0, sizeof(zeros));
+
+  // Only slot low time and sampling are done in place.
+  cpu_time("write 0xFF", ones, sizeof(ones), NULL, 0);
+  cpu_time("read", NULL, 0, rd, sizeof(rd));
+
+  // Write 0 slot is low for the whole slot.
+  cpu_time("write 0x00", zeros, sizeof(zeros), NULL, 0);
+
+  setup(1);
+  trans_init(&trans, false, NULL, 0, rd, 1);
+  CHECK(esp_ow_async_submit(&trans) == ESP_OW_OK);
+  run();
+  CHECK(trans.busy_cycles <= HOST_US(8 * 15));
+
+  // Reset pulse and recovery are not done in place.
+  setup(1);
+  trans_init(&trans, true, NULL, 0, NULL, 0);
+  CHECK(esp_ow_async_submit(&trans) == ESP_OW_OK);
+  run();
+  CHECK(result == ESP_OW_OK);
+  CHECK(trans.busy_cycles <= HOST_US(100));
+  CHECK(trans.total_cycles >= HOST_US(480));
+  printf("reset: busy %u us of %u us\n", trans.busy_cycles / HOST_CPU_MHZ, trans.total_cycles / HOST_CPU_MHZ);
+}
+
+int
+main()
+{
+  test_search();
+  test_match_read();
+  test_no_dev();
+  test_cpu_time();
+
+  return host_result();
+}